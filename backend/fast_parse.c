@@ -0,0 +1,247 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the HTTP course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the HTTP project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD
+#endif
+
+#include "fast_parse.h"
+
+/* tchar from RFC 7230, the characters allowed in methods and field names.
+  Same set the lexer's token class accepts */
+static bool token_chars[256];
+
+/**
+ * Finds the first byte that ends a URI (stop_space) or a field value:
+ * control characters other than HT, DEL, and for URIs also SP and HT.
+ * Returns n if there is none.
+ */
+typedef size_t (*find_delim_fn)(const unsigned char *p, size_t n, bool stop_space);
+
+static size_t find_delim_scalar(const unsigned char *p, size_t n, bool stop_space)
+{
+    unsigned char limit = stop_space ? ' ' : 0x1f;
+    for (size_t i = 0; i < n; i++)
+    {
+        unsigned char c = p[i];
+        if (((c <= limit) && (stop_space || (c != '\t'))) || (c == 0x7f))
+            return i;
+    }
+    return n;
+}
+
+#ifdef HAVE_X86_SIMD
+__attribute__((target("avx2")))
+static size_t find_delim_avx2(const unsigned char *p, size_t n, bool stop_space)
+{
+    const __m256i limit = _mm256_set1_epi8(stop_space ? ' ' : 0x1f);
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i del = _mm256_set1_epi8(0x7f);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+        // unsigned v <= limit
+        __m256i hit = _mm256_cmpeq_epi8(_mm256_min_epu8(v, limit), v);
+        if (!stop_space)
+            hit = _mm256_andnot_si256(_mm256_cmpeq_epi8(v, tab), hit);
+        hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, del));
+        unsigned mask = _mm256_movemask_epi8(hit);
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+    return i + find_delim_scalar(p + i, n - i, stop_space);
+}
+
+__attribute__((target("sse4.2")))
+static size_t find_delim_sse42(const unsigned char *p, size_t n, bool stop_space)
+{
+    // byte ranges to stop at, as pairs of inclusive bounds
+    static const char value_ranges[16] = "\x00\x08\x0a\x1f\x7f\x7f";
+    static const char uri_ranges[16] = "\x00\x20\x7f\x7f";
+    const __m128i ranges = _mm_loadu_si128((const __m128i *)(stop_space ? uri_ranges : value_ranges));
+    const int ranges_len = stop_space ? 4 : 6;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        int idx = _mm_cmpestri(ranges, ranges_len, v, 16,
+                               _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+        if (idx != 16)
+            return i + idx;
+    }
+    return i + find_delim_scalar(p + i, n - i, stop_space);
+}
+#endif
+
+static find_delim_fn find_delim = find_delim_scalar;
+static const char *isa = "scalar";
+
+__attribute__((constructor))
+static void fast_parse_init()
+{
+    const char *extra = "!#$%&'*+-.^_`|~";
+    for (int c = '0'; c <= '9'; c++)
+        token_chars[c] = true;
+    for (int c = 'a'; c <= 'z'; c++)
+        token_chars[c] = token_chars[c - 'a' + 'A'] = true;
+    for (; *extra; extra++)
+        token_chars[(unsigned char)*extra] = true;
+
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        find_delim = find_delim_avx2;
+        isa = "avx2";
+    }
+    else if (__builtin_cpu_supports("sse4.2"))
+    {
+        find_delim = find_delim_sse42;
+        isa = "sse4.2";
+    }
+#endif
+}
+
+const char *fast_parse_isa()
+{
+    return isa;
+}
+
+/**
+ * Checks for CRLF at i: TEST_ERROR_NONE if it is there, partial if the
+ * buffer ends first
+ */
+static test_error_code_t expect_crlf(const unsigned char *buf, size_t i, size_t size)
+{
+    if (i == size)
+        return TEST_ERROR_PARSE_PARTIAL;
+    if (buf[i] != '\r')
+        return TEST_ERROR_PARSE_FAILED;
+    if (i + 1 == size)
+        return TEST_ERROR_PARSE_PARTIAL;
+    if (buf[i + 1] != '\n')
+        return TEST_ERROR_PARSE_FAILED;
+    return TEST_ERROR_NONE;
+}
+
+static size_t skip_token(const unsigned char *buf, size_t i, size_t size)
+{
+    while ((i < size) && token_chars[buf[i]])
+        i++;
+    return i;
+}
+
+/**
+ * Checks for "token/d.d". Like the grammar, a protocol other than HTTP
+ * parses but leaves the version empty.
+ */
+static bool parse_version(const unsigned char *buf, Http_slice *version)
+{
+    const unsigned char *v = buf + version->off;
+    size_t slash = skip_token(v, 0, version->len);
+    if ((slash == 0) || (version->len != slash + 4) || (v[slash] != '/') ||
+        !isdigit(v[slash + 1]) || (v[slash + 2] != '.') || !isdigit(v[slash + 3]))
+        return false;
+    if ((slash != 4) || (memcmp(v, "HTTP", 4) != 0))
+        version->len = 0;
+    return true;
+}
+
+test_error_code_t parse_request_view(const char *buffer, size_t size, Request_view *view)
+{
+    const unsigned char *buf = (const unsigned char *)buffer;
+    size_t i = 0, start;
+    test_error_code_t err;
+
+    // method SP
+    start = i;
+    i = skip_token(buf, i, size);
+    if (i == size)
+        return TEST_ERROR_PARSE_PARTIAL;
+    if ((i == start) || (buf[i] != ' '))
+        return TEST_ERROR_PARSE_FAILED;
+    view->method.off = start;
+    view->method.len = i - start;
+    i++;
+
+    // request-target SP
+    start = i;
+    i += find_delim(buf + i, size - i, true);
+    if (i == size)
+        return TEST_ERROR_PARSE_PARTIAL;
+    if ((i == start) || (buf[i] != ' '))
+        return TEST_ERROR_PARSE_FAILED;
+    view->uri.off = start;
+    view->uri.len = i - start;
+    i++;
+
+    // HTTP-version CRLF
+    start = i;
+    i += find_delim(buf + i, size - i, false);
+    if ((err = expect_crlf(buf, i, size)) != TEST_ERROR_NONE)
+        return err;
+    view->version.off = start;
+    view->version.len = i - start;
+    if (!parse_version(buf, &view->version))
+        return TEST_ERROR_PARSE_FAILED;
+    i += 2;
+
+    // *( field-name ":" field-value CRLF ) CRLF
+    view->header_count = 0;
+    while (1)
+    {
+        if (i == size)
+            return TEST_ERROR_PARSE_PARTIAL;
+        if (buf[i] == '\r')
+        {
+            if ((err = expect_crlf(buf, i, size)) != TEST_ERROR_NONE)
+                return err;
+            view->header_size = i + 2;
+            return TEST_ERROR_NONE;
+        }
+
+        start = i;
+        i = skip_token(buf, i, size);
+        if (i == size)
+            return TEST_ERROR_PARSE_PARTIAL;
+        if ((i == start) || (buf[i] != ':'))
+            return TEST_ERROR_PARSE_FAILED;
+        if (view->header_count == FAST_PARSE_MAX_HEADERS)
+            return TEST_ERROR_PARSE_FAILED;
+        Http_header_slice *header = &view->headers[view->header_count];
+        header->name.off = start;
+        header->name.len = i - start;
+        i++;
+
+        start = i;
+        while (1)
+        {
+            i += find_delim(buf + i, size - i, false);
+            if ((err = expect_crlf(buf, i, size)) != TEST_ERROR_NONE)
+                return err;
+            // looking at the next line decides whether the value ends here
+            if (i + 2 == size)
+                return TEST_ERROR_PARSE_PARTIAL;
+            // obs-fold, the value goes on in the next line
+            if ((buf[i + 2] != ' ') && (buf[i + 2] != '\t'))
+                break;
+            i += 3;
+        }
+        header->value.off = start;
+        header->value.len = i - start;
+        view->header_count++;
+        i += 2;
+    }
+}
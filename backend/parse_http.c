@@ -8,10 +8,17 @@
  * No part of the HTTP project may be copied and/or distributed
  * without the express permission of the 15-441/641 course staff.
  */
+#define _GNU_SOURCE
 #include <string.h>
+#include <strings.h>
+#include <stdarg.h>
 #include "parse_http.h"
+#include "fast_parse.h"
+#include "log.h"
 #include <sys/stat.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
 
 #include <dirent.h>
 
@@ -19,7 +26,7 @@ void trim_whitespace(char *input, size_t length)
 {
     if (input == NULL)
     {
-        fprintf(stderr, "Error: Input string is NULL.\n");
+        LOG_ERROR("trim_whitespace: input string is NULL");
         return;
     }
 
@@ -30,38 +37,16 @@ void trim_whitespace(char *input, size_t length)
         start++;
     }
 
-    // Find the index of the first non-whitespace character from the end
-    size_t end = length - 1;
-    while (end > start && isspace(input[end]))
+    // Find the end of the string without the trailing whitespace
+    size_t end = length;
+    while (end > start && isspace(input[end - 1]))
     {
         end--;
     }
 
-    // Calculate the length of the trimmed string
-    size_t trimmed_length = (end >= start) ? (end - start + 1) : 0;
-
-    // Allocate memory for the trimmed string
-    char *result = (char *)malloc((trimmed_length + 1) * sizeof(char));
-    if (result == NULL)
-    {
-        fprintf(stderr, "Error: Memory allocation failed.\n");
-        return;
-    }
-
-    // Copy the trimmed portion of the input string to the result
-    strncpy(result, input + start, trimmed_length);
-
-    // Add the null terminator at the end
-    result[trimmed_length] = '\0';
-
-    // Copy the trimmed string back.
-    // Note: there should not be another null temrinator in the string.
-    // Be careful about how strcpy() works: https://linux.die.net/man/3/strcpy
-    strcpy(input, result);
-    // Make sure to free the temporary string.
-    free(result);
-
-    return;
+    // Move the trimmed string to the front, in place
+    memmove(input, input + start, end - start);
+    input[end - start] = '\0';
 }
 
 void to_lower(char *str, size_t str_len)
@@ -73,194 +58,617 @@ void to_lower(char *str, size_t str_len)
 }
 
 /**
- * Wrapper for serializing an error HTTP response.
- * @param pointer message
- * @param response_type
+ * Fills in a response that has no body besides the serialized one
  */
-char *serialize_http_response_wrapper(size_t *len, const char *response_type)
+static void set_memory_response(Response *response, char *msg, size_t len)
 {
-    char *resp_text;
-    serialize_http_response(&resp_text, len, response_type, NULL, NULL, NULL, 0, NULL);
-    return resp_text;
+    response->path = NULL;
+    response->header = msg;
+    response->header_len = len;
+    response->body_fd = -1;
+    response->body_offset = 0;
+    response->body_len = 0;
 }
 
-// get file size
-// @param char* file_path (path to resource)
-size_t get_file_size(char *file_path)
+static void set_error_response(Response *response, Http_status status)
 {
-    struct stat st;
-    // to-do add error handling robustness
-    stat(file_path, &st);
-    return st.st_size;
-}
-
-char *size_to_string(size_t size)
-{
-    char *size_str = malloc(32); // Allocate memory for the formatted string
-    if (size_str == NULL)
-    {
-        perror("Error allocating memory for Content-Length");
-        return NULL;
-    }
-    snprintf(size_str, 32, "%zu", size); // Format the size
-    return size_str;
+    size_t len;
+    const char *msg = error_response(status, &len);
+    set_memory_response(response, (char *)msg, len);
+    response->status = status;
 }
 
 /**
- * Given a char buffer returns the parsed request headers
+ * Builds the response to a request for a static file. Files of at least
+ * SENDFILE_MIN_SIZE bytes are left open in response->body_fd so the caller
+ * can sendfile() them, only the headers are built in memory. Everything else
+ * comes from arena.
  */
-char *process_http_request(Request *request, size_t *len, char *base_folder)
+test_error_code_t process_http_request(Request *request, Response *response, char *base_folder,
+                                       struct arena *arena)
 {
-        static const char *index_str = "/index.html";
+        size_t len;
 
         char *http_resource_path = request->http_uri;
 
         // unexpected behavior in this method...
         if (http_resource_path[0] != '/')
         {
-            printf("NO RESOURCE indicated \n");
-            return serialize_http_response_wrapper(len, BAD_REQUEST);
+            LOG_DEBUG("no resource indicated");
+            set_error_response(response, HTTP_400);
+            return TEST_ERROR_NONE;
         }
 
         // concating base dir and file path
         int path_len = strlen(base_folder) + strlen(http_resource_path);
 
-        char *resource_path = (char *)malloc(path_len + strlen(index_str) + 1);
+        char *resource_path = arena_alloc(arena, path_len + strlen(INDEX_FILE) + 1);
+        if (resource_path == NULL)
+        {
+            set_error_response(response, HTTP_500);
+            return TEST_ERROR_NONE;
+        }
         strcpy(resource_path, base_folder);
         strcat(resource_path, http_resource_path);
 
-        if (access(resource_path, F_OK) != 0)
+        LOG_DEBUG("resource requested: %s", resource_path);
+        int fd = open(resource_path, O_RDONLY);
+        struct stat st;
+        if ((fd >= 0) && (fstat(fd, &st) == 0) && S_ISDIR(st.st_mode))
         {
-            printf("RESOURCE NOT FOUND: %s\n", resource_path);
-            return serialize_http_response_wrapper(len, NOT_FOUND);
+            /* resource_path points to a directory */
+            close(fd);
+            strcat(resource_path, INDEX_FILE);
+            LOG_DEBUG("directory requested, new request is %s", resource_path);
+            fd = open(resource_path, O_RDONLY);
+        }
+        if (fd < 0)
+        {
+            int missing = (errno == ENOENT) || (errno == ENOTDIR);
+            LOG_DEBUG("resource not found: %s", resource_path);
+            set_error_response(response, missing ? HTTP_404 : HTTP_500);
+            return TEST_ERROR_NONE;
+        }
+        if ((fstat(fd, &st) != 0) || !S_ISREG(st.st_mode))
+        {
+            close(fd);
+            set_error_response(response, HTTP_500);
+            return TEST_ERROR_NONE;
         }
 
-        /* check if resource_path points to a directory */
+        size_t resource_file_size = st.st_size;
+        // a compressible file has a gzip variant, caches have to tell them apart
+        size_t header_len = serialize_file_header(response->head, HTTP_200, NULL,
+                                                  resource_file_size, &st,
+                                                  is_compressible(resource_path) ? RESPONSE_VARY : 0);
 
-        printf("resource requested: %s\n", resource_path);
-        DIR *dir = opendir(resource_path);
-        if (dir != NULL)
+        if (resource_file_size >= SENDFILE_MIN_SIZE)
         {
-            // int s = (resource_path[strlen(resource_path) - 1] == '/');
-            // strcat(resource_path, index_str + s);
-            strcat(resource_path, index_str);
-            printf("Directory requested, new request is %s\n", resource_path);
-            closedir(dir);
+            // headers only, the body goes out straight from the file
+            response->status = HTTP_200;
+            response->header = response->head;
+            response->header_len = header_len;
+            response->body_fd = fd;
+            response->body_offset = 0;
+            response->body_len = resource_file_size;
+            response->path = resource_path;
+            response->file_stat = st;
+            return TEST_ERROR_NONE;
         }
 
-        FILE *resource_file = fopen(resource_path, "rb");
-        if (resource_file == NULL)
+        // small file, read it in right behind the headers
+        len = header_len + resource_file_size;
+        char *msg = arena_alloc(arena, len);
+        if (msg == NULL)
         {
-            return serialize_http_response_wrapper(len, INTERNAL_SERVER_ERROR);
+            close(fd);
+            set_error_response(response, HTTP_500);
+            return TEST_ERROR_NONE;
         }
-
-        size_t resource_file_size = get_file_size(resource_path);
-
-        char *resource_file_content = malloc(resource_file_size);
-        if (resource_file_content == NULL)
+        memcpy(msg, response->head, header_len);
+        size_t done = 0;
+        while (done < resource_file_size)
         {
-            fclose(resource_file);
-            free(resource_path);
-            return serialize_http_response_wrapper(len, INTERNAL_SERVER_ERROR);
+            ssize_t n = pread(fd, msg + header_len + done, resource_file_size - done, done);
+            if (n <= 0)
+            {
+                close(fd);
+                set_error_response(response, HTTP_500);
+                return TEST_ERROR_NONE;
+            }
+            done += n;
         }
+        close(fd);
+        set_memory_response(response, msg, len);
+        response->status = HTTP_200;
+        response->path = resource_path;
+        response->file_stat = st;
+        return TEST_ERROR_NONE;
+}
 
-        fread(resource_file_content, 1, resource_file_size, resource_file);
+static Parser_mode parser_mode = PARSER_FAST;
 
-        char *content_length_str = size_to_string(resource_file_size);
-        char *response;
-        serialize_http_response(&response, len, OK, NULL, content_length_str, NULL, resource_file_size, resource_file_content);
+void set_parser_mode(Parser_mode mode)
+{
+    parser_mode = mode;
+}
 
-        fclose(resource_file);
-        free(resource_file_content);
-        free(resource_path);
-        free(content_length_str);
-        return response;
+Parser_mode get_parser_mode()
+{
+    return parser_mode;
 }
 
 /**
- * Given a char buffer returns the parsed request headers
+ * Looks for the CRLFCRLF that ends the headers, starting at *pos. Returns
+ * true with *pos just past it, or false with *pos at the first byte a match
+ * could still start at once more data arrives.
  */
-test_error_code_t parse_http_request(char *buffer, size_t size, Request *request)
+static bool find_header_end(const char *buffer, size_t size, size_t *pos)
 {
-    // Differant states in the state machine
-    enum
+    size_t i = *pos;
+    while (i < size)
     {
-        STATE_START = 0,
-        STATE_CR,
-        STATE_CRLF,
-        STATE_CRLFCR,
-        STATE_CRLFCRLF
-    };
+        const char *cr = memchr(buffer + i, '\r', size - i);
+        if (cr == NULL)
+            break;
+        i = cr - buffer;
+        if (size - i < 4)
+        {
+            *pos = i;
+            return false;
+        }
+        if (memcmp(cr, "\r\n\r\n", 4) == 0)
+        {
+            *pos = i + 4;
+            return true;
+        }
+        i++;
+    }
+    *pos = size;
+    return false;
+}
 
-    int i = 0, state;
-    size_t offset = 0;
-    char ch;
-    // Safe to assume that every valid request has header smaller than
-    // 8192 bytes. This buf does not hold body content.
-    char buf[8192];
-    memset(buf, 0, 8192);
+static const struct
+{
+    Http_template name;
+    Http_header_id id;
+} KNOWN_HEADERS[] = {
+    {{"Host", 4}, HEADER_HOST},
+    {{"Content-Length", 14}, HEADER_CONTENT_LENGTH},
+    {{"Connection", 10}, HEADER_CONNECTION},
+    {{"If-None-Match", 13}, HEADER_IF_NONE_MATCH},
+    {{"Range", 5}, HEADER_RANGE},
+    {{"Accept-Encoding", 15}, HEADER_ACCEPT_ENCODING},
+    {{"If-Range", 8}, HEADER_IF_RANGE},
+    {{"If-Modified-Since", 17}, HEADER_IF_MODIFIED_SINCE},
+};
+
+bool request_add_header(Request *request, Http_slice name, Http_slice value)
+{
+    if (request->header_count == MAX_REQUEST_HEADERS)
+        return false;
 
-    state = STATE_START;
-    while (state != STATE_CRLFCRLF)
+    const char *v = request->buf + value.off;
+    while ((value.len > 0) && isspace((unsigned char)v[0]))
     {
-        char expected = 0;
+        v++;
+        value.off++;
+        value.len--;
+    }
+    while ((value.len > 0) && isspace((unsigned char)v[value.len - 1]))
+        value.len--;
 
-        if (i == size)
+    // the names all differ in length, so at most one strncasecmp() runs
+    for (size_t i = 0; i < sizeof(KNOWN_HEADERS) / sizeof(KNOWN_HEADERS[0]); i++)
+    {
+        if ((name.len == KNOWN_HEADERS[i].name.len) &&
+            (strncasecmp(request->buf + name.off, KNOWN_HEADERS[i].name.str, name.len) == 0))
+        {
+            // the first one wins
+            if (request->known[KNOWN_HEADERS[i].id] < 0)
+                request->known[KNOWN_HEADERS[i].id] = request->header_count;
             break;
+        }
+    }
+
+    request->headers[request->header_count].name = name;
+    request->headers[request->header_count].value = value;
+    request->header_count++;
+    return true;
+}
+
+const char *request_header(const Request *request, Http_header_id id, size_t *len)
+{
+    if (request->known[id] < 0)
+        return NULL;
+    const Http_slice *value = &request->headers[request->known[id]].value;
+    *len = value->len;
+    return request->buf + value->off;
+}
+
+bool request_header_is(const Request *request, Http_header_id id, const char *value)
+{
+    size_t len;
+    const char *v = request_header(request, id, &len);
+    return (v != NULL) && (len == strlen(value)) && (strncasecmp(v, value, len) == 0);
+}
 
-        ch = buffer[i++];
-        buf[offset++] = ch;
+bool request_accepts_encoding(const Request *request, const char *coding)
+{
+    size_t len;
+    const char *v = request_header(request, HEADER_ACCEPT_ENCODING, &len);
+    if (v == NULL)
+        return false;
+
+    size_t coding_len = strlen(coding);
+    const char *end = v + len;
+    bool wildcard = false;
+    while (v < end)
+    {
+        // one "coding;q=x" element of the comma separated list
+        const char *comma = memchr(v, ',', end - v);
+        const char *item_end = comma == NULL ? end : comma;
+        while ((v < item_end) && isspace((unsigned char)*v))
+            v++;
+        const char *name = v;
+        while ((v < item_end) && (*v != ';') && !isspace((unsigned char)*v))
+            v++;
+        size_t name_len = v - name;
 
-        switch (state)
+        // q=0, 0.0, 0.00 or 0.000 turns the coding off
+        bool refused = false;
+        const char *q = v;
+        while ((q = memchr(q, ';', item_end - q)) != NULL)
         {
-        case STATE_START:
-        case STATE_CRLF:
-            expected = '\r';
-            break;
-        case STATE_CR:
-        case STATE_CRLFCR:
-            expected = '\n';
-            break;
-        default:
-            state = STATE_START;
-            continue;
+            q++;
+            while ((q < item_end) && isspace((unsigned char)*q))
+                q++;
+            if ((item_end - q >= 2) && ((q[0] == 'q') || (q[0] == 'Q')) && (q[1] == '='))
+            {
+                const char *d = q + 2;
+                refused = (d < item_end) && (*d == '0');
+                for (d++; refused && (d < item_end) && !isspace((unsigned char)*d); d++)
+                    refused = (*d == '.') || (*d == '0');
+            }
         }
 
-        if (ch == expected)
-            state++;
-        else
-            state = STATE_START;
+        if ((name_len == coding_len) && (strncasecmp(name, coding, name_len) == 0))
+            return !refused;
+        if ((name_len == 1) && (name[0] == '*'))
+            wildcard = !refused;
+        v = comma == NULL ? end : comma + 1;
     }
+    return wildcard;
+}
 
-    // Valid End State
-    if (state == STATE_CRLFCRLF)
+/**
+ * Reads the digits at *p, up to end. Returns false if there are none or the
+ * number doesn't fit in an off_t.
+ */
+static bool parse_offset(const char **p, const char *end, off_t *value)
+{
+    const char *start = *p;
+    off_t v = 0;
+    while ((*p < end) && isdigit((unsigned char)**p))
     {
-        request->header_count = 0;
-        request->status_header_size = 0;
-        request->allocated_headers = 15;
+        if (*p - start >= 18)
+            return false;
+        v = v * 10 + (**p - '0');
+        (*p)++;
+    }
+    *value = v;
+    return *p > start;
+}
+
+Range_result request_ranges(const Request *request, off_t size, Http_range *ranges, int *count)
+{
+    size_t len;
+    const char *p = request_header(request, HEADER_RANGE, &len);
+    *count = 0;
+    if ((p == NULL) || (len < 6) || (strncasecmp(p, "bytes=", 6) != 0))
+        return RANGE_NONE;
+    const char *end = p + len;
+    p += 6;
 
-        request->headers = (Request_header *)malloc(sizeof(Request_header) * request->allocated_headers);
-        set_parsing_options(buf, i, request);
+    bool seen = false, any = false;
+    while (p < end)
+    {
+        while ((p < end) && ((*p == ' ') || (*p == '\t') || (*p == ',')))
+            p++;
+        if (p == end)
+            break;
+        seen = true;
 
-        yyrestart(NULL);
-        if (yyparse() == SUCCESS)
+        off_t first, last;
+        bool suffix = (*p == '-');
+        if (suffix)
         {
-            request->valid = true;
-            for (int i = 0; i < request->header_count; ++i)
+            p++;
+            if (!parse_offset(&p, end, &last))
+                return RANGE_NONE;
+            // the last n bytes, all of them if the file is shorter
+            first = last >= size ? 0 : size - last;
+            last = size - 1;
+            if (last < first)
+                continue; // -0, or an empty file
+        }
+        else
+        {
+            if (!parse_offset(&p, end, &first) || (p == end) || (*p++ != '-'))
+                return RANGE_NONE;
+            if ((p < end) && isdigit((unsigned char)*p))
             {
-                Request_header *header = &request->headers[i];
-                printf("header->header_name: %s\n", header->header_name);
-
-                trim_whitespace(header->header_name, strlen(header->header_name));
-                to_lower(header->header_name, strlen(header->header_name));
-                trim_whitespace(header->header_value, strlen(header->header_value));
-                to_lower(header->header_value, strlen(header->header_value));
+                if (!parse_offset(&p, end, &last) || (last < first))
+                    return RANGE_NONE;
+                if (last >= size)
+                    last = size - 1;
             }
-            return TEST_ERROR_NONE;
+            else
+            {
+                last = size - 1;
+            }
+            if (first >= size)
+                continue;
+        }
+        while ((p < end) && ((*p == ' ') || (*p == '\t')))
+            p++;
+        if ((p < end) && (*p != ','))
+            return RANGE_NONE;
+
+        any = true;
+        // so many ranges may be an attempt to make us do lots of small sends
+        if (*count == MAX_RANGES)
+            return RANGE_NONE;
+        ranges[*count].start = first;
+        ranges[*count].len = last - first + 1;
+        (*count)++;
+    }
+    if (!seen)
+        return RANGE_NONE;
+    if (!any)
+        return RANGE_UNSATISFIABLE;
+    return RANGE_OK;
+}
+
+bool request_etag_matches(const Request *request, const char *etag, size_t len)
+{
+    size_t list_len;
+    const char *p = request_header(request, HEADER_IF_NONE_MATCH, &list_len);
+    if (p == NULL)
+        return false;
+    const char *end = p + list_len;
+    while (p < end)
+    {
+        while ((p < end) && ((*p == ' ') || (*p == '\t') || (*p == ',')))
+            p++;
+        if (p == end)
+            break;
+        if (*p == '*')
+            return true;
+        // weak comparison: W/"x" matches "x"
+        if ((end - p >= 2) && (p[0] == 'W') && (p[1] == '/'))
+            p += 2;
+        const char *tag = p;
+        if ((p < end) && (*p == '"'))
+        {
+            const char *close = memchr(p + 1, '"', end - p - 1);
+            p = close == NULL ? end : close + 1;
+        }
+        else
+        {
+            while ((p < end) && (*p != ','))
+                p++;
         }
+        if (((size_t)(p - tag) == len) && (memcmp(tag, etag, len) == 0))
+            return true;
+        while ((p < end) && (*p != ','))
+            p++;
+    }
+    return false;
+}
+
+bool parse_http_date(const char *str, size_t len, time_t *when)
+{
+    char date[64];
+    if (len >= sizeof(date))
+        return false;
+    memcpy(date, str, len);
+    date[len] = '\0';
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    const char *end = strptime(date, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    if ((end == NULL) || (*end != '\0'))
+        return false;
+    *when = timegm(&tm);
+    return true;
+}
+
+bool is_compressible(const char *path)
+{
+    static const char *const extensions[] = {
+        "html", "htm", "css", "js", "txt", "json", "xml", "svg",
+    };
+    const char *dot = strrchr(path, '.');
+    if ((dot == NULL) || (strchr(dot, '/') != NULL))
+        return false;
+    for (size_t i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++)
+        if (strcasecmp(dot + 1, extensions[i]) == 0)
+            return true;
+    return false;
+}
+
+/**
+ * Runs the flex/bison parser over the first size bytes of buffer, which end
+ * with the CRLFCRLF
+ */
+static test_error_code_t parse_http_request_bison(char *buffer, size_t size, Request *request)
+{
+    // One scanner per thread, made on first use and reused after that
+    static __thread Parse_context ctx;
+    if ((ctx.scanner == NULL) && (parse_context_init(&ctx) != 0))
         return TEST_ERROR_PARSE_FAILED;
+
+    // The lexer reads straight from the caller's buffer, up to the end
+    // of the headers.
+    parse_context_reset(&ctx, buffer, size, request);
+
+    if (yyparse(ctx.scanner, &ctx) == SUCCESS)
+        return TEST_ERROR_NONE;
+    return TEST_ERROR_PARSE_FAILED;
+}
+
+/**
+ * Same as parse_http_request_bison(), with parse_request_view() doing the
+ * parsing
+ */
+static test_error_code_t parse_http_request_fast(char *buffer, size_t size, Request *request)
+{
+    Request_view view;
+    if (parse_request_view(buffer, size, &view) != TEST_ERROR_NONE)
+        return TEST_ERROR_PARSE_FAILED;
+
+    request->method = view.method;
+    request->uri = view.uri;
+    request->version = view.version;
+    for (int i = 0; i < view.header_count; i++)
+    {
+        if (!request_add_header(request, view.headers[i].name, view.headers[i].value))
+            return TEST_ERROR_PARSE_FAILED;
+    }
+    return TEST_ERROR_NONE;
+}
+
+/**
+ * Copies a slice into a fixed size field, false if it does not fit
+ */
+static bool copy_slice(char *dst, size_t dst_size, const char *buffer, Http_slice slice)
+{
+    if (slice.len >= dst_size)
+        return false;
+    memcpy(dst, buffer + slice.off, slice.len);
+    dst[slice.len] = '\0';
+    return true;
+}
+
+/**
+ * Post-processing both parsers share
+ */
+static test_error_code_t finish_request(Request *request, size_t header_size)
+{
+    if (!copy_slice(request->http_method, sizeof(request->http_method), request->buf, request->method) ||
+        !copy_slice(request->http_uri, sizeof(request->http_uri), request->buf, request->uri) ||
+        !copy_slice(request->http_version, sizeof(request->http_version), request->buf, request->version))
+        return TEST_ERROR_PARSE_FAILED;
+
+    size_t len;
+    const char *content_length = request_header(request, HEADER_CONTENT_LENGTH, &len);
+    if (content_length != NULL)
+    {
+        // digits only, and few enough that they can't overflow
+        if ((len == 0) || (len > 18))
+            return TEST_ERROR_PARSE_FAILED;
+        for (size_t i = 0; i < len; i++)
+        {
+            if (!isdigit((unsigned char)content_length[i]))
+                return TEST_ERROR_PARSE_FAILED;
+            request->content_length = 10 * request->content_length + (content_length[i] - '0');
+        }
+    }
+
+    request->valid = true;
+    // The body, if any, starts right after the CRLFCRLF
+    request->status_header_size = header_size;
+    return TEST_ERROR_NONE;
+}
+
+static void reset_request(Request *request, const char *buffer)
+{
+    request->http_method[0] = '\0';
+    request->http_uri[0] = '\0';
+    request->http_version[0] = '\0';
+    request->buf = buffer;
+    request->header_count = 0;
+    memset(request->known, -1, sizeof(request->known));
+    request->status_header_size = 0;
+    request->content_length = 0;
+    request->valid = false;
+}
+
+static bool same_slice(Http_slice a, Http_slice b)
+{
+    return (a.off == b.off) && (a.len == b.len);
+}
+
+static bool same_request(const Request *a, const Request *b)
+{
+    if (!same_slice(a->method, b->method) || !same_slice(a->uri, b->uri) ||
+        !same_slice(a->version, b->version) || (a->header_count != b->header_count))
+        return false;
+    for (int i = 0; i < a->header_count; i++)
+    {
+        if (!same_slice(a->headers[i].name, b->headers[i].name) ||
+            !same_slice(a->headers[i].value, b->headers[i].value))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Runs both parsers and reports where they disagree, bison's result is the
+ * one returned
+ */
+static test_error_code_t parse_http_request_diff(char *buffer, size_t size, Request *request)
+{
+    Request fast;
+    reset_request(&fast, buffer);
+    test_error_code_t fast_err = parse_http_request_fast(buffer, size, &fast);
+    if (fast_err == TEST_ERROR_NONE)
+        fast_err = finish_request(&fast, size);
+
+    test_error_code_t err = parse_http_request_bison(buffer, size, request);
+    if (err == TEST_ERROR_NONE)
+        err = finish_request(request, size);
+
+    if ((err != fast_err) || ((err == TEST_ERROR_NONE) && !same_request(request, &fast)))
+        LOG_WARN("parser mismatch: bison %d, fast %d on %zu bytes:\n%.*s",
+                 err, fast_err, size, (int)size, buffer);
+    return err;
+}
+
+/**
+ * Given a char buffer returns the parsed request headers
+ */
+test_error_code_t parse_http_request(char *buffer, size_t size, Request *request, size_t *scan_offset)
+{
+    // Resuming where the last call stopped is safe because that is where a
+    // partial CRLFCRLF match would start.
+    size_t i = scan_offset == NULL ? 0 : *scan_offset;
+    bool found = find_header_end(buffer, size, &i);
+    if (scan_offset != NULL)
+        *scan_offset = i;
+
+    if (!found)
+    {
+        // Headers that never end are not going to become valid
+        if (i > MAX_HEADER_SIZE)
+            return TEST_ERROR_PARSE_FAILED;
+        return TEST_ERROR_PARSE_PARTIAL;
     }
-    return TEST_ERROR_PARSE_PARTIAL;
+
+    reset_request(request, buffer);
+    // Safe to assume that every valid request has header smaller than
+    // MAX_HEADER_SIZE bytes.
+    if (i > MAX_HEADER_SIZE)
+        return TEST_ERROR_PARSE_FAILED;
+
+    if (parser_mode == PARSER_DIFF)
+        return parse_http_request_diff(buffer, i, request);
+
+    test_error_code_t err = parser_mode == PARSER_FAST ? parse_http_request_fast(buffer, i, request)
+                                                       : parse_http_request_bison(buffer, i, request);
+    if (err == TEST_ERROR_NONE)
+        err = finish_request(request, i);
+    return err;
 }
 
 /**
@@ -292,17 +700,22 @@ test_error_code_t serialize_http_request(char *buffer, size_t *size, Request *re
     p += strlen(CRLF);
     *size += strlen(CRLF);
 
-    memcpy(p, HOST, strlen(HOST));
-    p += strlen(HOST);
-    *size += strlen(HOST);
+    size_t host_len;
+    const char *host = request_header(request, HEADER_HOST, &host_len);
+    if (host != NULL)
+    {
+        memcpy(p, HOST, strlen(HOST));
+        p += strlen(HOST);
+        *size += strlen(HOST);
 
-    memcpy(p, request->host, strlen(request->host));
-    p += strlen(request->host);
-    *size += strlen(request->host);
+        memcpy(p, host, host_len);
+        p += host_len;
+        *size += host_len;
 
-    memcpy(p, CRLF, strlen(CRLF));
-    p += strlen(CRLF);
-    *size += strlen(CRLF);
+        memcpy(p, CRLF, strlen(CRLF));
+        p += strlen(CRLF);
+        *size += strlen(CRLF);
+    }
 
     memcpy(p, CONNECTION, strlen(CONNECTION));
     p += strlen(CONNECTION);
@@ -326,96 +739,510 @@ test_error_code_t serialize_http_request(char *buffer, size_t *size, Request *re
     return TEST_ERROR_NONE;
 }
 
+void response_parser_reset(Http_response_parser *parser)
+{
+    parser->state = RESPONSE_PARSE_HEADERS;
+    parser->status = 0;
+    parser->header_count = 0;
+    parser->header_size = 0;
+    parser->chunked = false;
+    parser->keep_alive = true;
+    parser->content_length = 0;
+    parser->remaining = 0;
+    parser->body_len = 0;
+    parser->scan_offset = 0;
+}
+
+static bool slice_is(const char *buffer, Http_slice slice, const char *str)
+{
+    return strlen(str) == slice.len && strncasecmp(buffer + slice.off, str, slice.len) == 0;
+}
+
 /**
- * Given a char buffer returns the parsed request headers
+ * Whether a comma-separated header value has the token, ignoring case
+ */
+static bool has_token(const char *value, size_t len, const char *token)
+{
+    size_t token_len = strlen(token);
+    const char *end = value + len;
+    while (value < end)
+    {
+        while (value < end && (*value == ' ' || *value == '\t' || *value == ','))
+            value++;
+        const char *comma = memchr(value, ',', end - value);
+        const char *item_end = comma == NULL ? end : comma;
+        const char *last = item_end;
+        while (last > value && (last[-1] == ' ' || last[-1] == '\t'))
+            last--;
+        if ((size_t)(last - value) == token_len && strncasecmp(value, token, token_len) == 0)
+            return true;
+        value = item_end;
+    }
+    return false;
+}
+
+/**
+ * Parses the status line and headers, buffer[0, size) ending with CRLFCRLF,
+ * and works out how the body is delimited
  */
-test_error_code_t serialize_http_response(char **msg, size_t *len, const char *prepopulated_headers, char *content_type,
-                                          char *content_length, char *last_modified, size_t body_len, char *body)
+static test_error_code_t parse_response_head(Http_response_parser *parser, const char *buffer, size_t size)
 {
-    char date[4096];
-    time_t now;
-    time(&now);
-    struct tm *now_tm = localtime(&now);
-    strftime(date, 4096, "%a, %d %b %Y %H:%M:%S %Z", now_tm);
+    // "HTTP/1.x 200 OK\r\n", the reason phrase may be empty
+    if (size < 14 || memcmp(buffer, "HTTP/1.", 7) != 0 || !isdigit((unsigned char)buffer[7]) ||
+        buffer[8] != ' ' || !isdigit((unsigned char)buffer[9]) || !isdigit((unsigned char)buffer[10]) ||
+        !isdigit((unsigned char)buffer[11]) || (buffer[12] != ' ' && buffer[12] != '\r'))
+        return TEST_ERROR_PARSE_FAILED;
+    parser->status = (buffer[9] - '0') * 100 + (buffer[10] - '0') * 10 + (buffer[11] - '0');
+    bool http10 = buffer[7] == '0';
+    parser->keep_alive = !http10;
 
-    size_t date_len = strlen(date);
-    size_t content_type_len = content_type == NULL ? 0 : strlen(content_type);
-    size_t content_length_len = content_length == NULL ? 0 : strlen(content_length);
-    size_t last_modified_len = last_modified == NULL ? 0 : strlen(last_modified);
+    const char *line = memchr(buffer, '\n', size);
+    bool has_length = false;
+    bool has_encoding = false;
+    const char *end = buffer + size - 2; // the empty line
+    for (line++; line < end;)
+    {
+        const char *eol = memchr(line, '\n', end - line + 1);
+        if (eol == NULL || eol == line || eol[-1] != '\r')
+            return TEST_ERROR_PARSE_FAILED;
+        // obsolete line folding is not worth supporting
+        if (*line == ' ' || *line == '\t')
+            return TEST_ERROR_PARSE_FAILED;
+        const char *colon = memchr(line, ':', eol - line);
+        if (colon == NULL || colon == line || parser->header_count == MAX_RESPONSE_HEADERS)
+            return TEST_ERROR_PARSE_FAILED;
+        const char *value = colon + 1;
+        const char *value_end = eol - 1;
+        while (value < value_end && (*value == ' ' || *value == '\t'))
+            value++;
+        while (value_end > value && (value_end[-1] == ' ' || value_end[-1] == '\t'))
+            value_end--;
 
-    size_t prepopulated_len = strlen(prepopulated_headers);
-    size_t msg_len = prepopulated_len + strlen(HTTP_VER) + 1 + strlen(CONNECTION) + strlen(CONNECTION_VAL) + strlen(CRLF) + strlen(SERVER) + strlen(SERVER_VAL) + strlen(CRLF) + strlen(DATE) + date_len + strlen(CRLF);
-    if (content_type != NULL)
+        Http_header_slice *header = &parser->headers[parser->header_count++];
+        header->name = (Http_slice){line - buffer, colon - line};
+        header->value = (Http_slice){value - buffer, value_end - value};
+        size_t value_len = value_end - value;
+        if (slice_is(buffer, header->name, "Content-Length"))
+        {
+            char *num_end;
+            if (value_len == 0 || !isdigit((unsigned char)*value))
+                return TEST_ERROR_PARSE_FAILED;
+            errno = 0;
+            unsigned long long length = strtoull(value, &num_end, 10);
+            // a repeated Content-Length has to agree with the first one
+            if (num_end != value_end || errno == ERANGE || length > SIZE_MAX ||
+                (has_length && length != parser->content_length))
+                return TEST_ERROR_PARSE_FAILED;
+            parser->content_length = length;
+            has_length = true;
+        }
+        else if (slice_is(buffer, header->name, "Transfer-Encoding"))
+        {
+            has_encoding = true;
+            // chunked has to be the last coding, anything else runs until
+            // the connection closes
+            const char *last = value_end;
+            while (last > value && last[-1] != ',')
+                last--;
+            parser->chunked = has_token(last, value_end - last, "chunked");
+        }
+        else if (slice_is(buffer, header->name, "Connection"))
+        {
+            if (has_token(value, value_len, "close"))
+                parser->keep_alive = false;
+            else if (http10 && has_token(value, value_len, "keep-alive"))
+                parser->keep_alive = true;
+        }
+        line = eol + 1;
+    }
+
+    parser->header_size = size;
+    if (parser->head || parser->status / 100 == 1 || parser->status == 204 || parser->status == 304)
     {
-        msg_len += strlen(CONTENT_TYPE) + content_type_len + strlen(CRLF);
+        parser->state = RESPONSE_PARSE_DONE;
     }
-    if (content_length != NULL)
+    else if (parser->chunked)
     {
-        msg_len += strlen(CONTENT_LENGTH) + content_length_len + strlen(CRLF);
+        parser->state = RESPONSE_PARSE_CHUNK_SIZE;
+    }
+    else if (has_length && !has_encoding)
+    {
+        parser->remaining = parser->content_length;
+        parser->state = parser->remaining == 0 ? RESPONSE_PARSE_DONE : RESPONSE_PARSE_BODY;
     }
     else
     {
-        msg_len += strlen(CONTENT_LENGTH) + strlen(ZERO) + strlen(CRLF);
+        parser->state = RESPONSE_PARSE_UNTIL_CLOSE;
+        parser->keep_alive = false;
     }
-    if (last_modified != NULL)
+    return TEST_ERROR_NONE;
+}
+
+/**
+ * Hands body bytes to the parser's sinks
+ */
+static bool deliver_body(Http_response_parser *parser, const char *data, size_t len)
+{
+    parser->body_len += len;
+    if (parser->body_fd >= 0)
     {
-        msg_len += strlen(CONTENT_TYPE) + last_modified_len + strlen(CRLF);
+        for (size_t done = 0; done < len;)
+        {
+            ssize_t n = write(parser->body_fd, data + done, len - done);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            done += n;
+        }
     }
-    msg_len += strlen(CRLF);
-    msg_len += body_len;
-    *len = msg_len;
+    return parser->on_body == NULL || parser->on_body(parser->user, data, len);
+}
 
-    *msg = calloc(msg_len, sizeof(char));
+/**
+ * Parses the size line of a chunk. Returns false if it is malformed,
+ * *len is 0 if the line is not all there yet.
+ */
+static bool parse_chunk_size(const char *buffer, size_t size, size_t *len, size_t *chunk_size)
+{
+    *len = 0;
+    const char *eol = memchr(buffer, '\n', size);
+    if (eol == NULL)
+        return size < MAX_HEADER_SIZE;
+    if (eol == buffer || eol[-1] != '\r')
+        return false;
 
-    size_t cur_len = 0;
-    // Prepopulated
-    memcpy(*msg + cur_len, HTTP_VER, strlen(HTTP_VER));
-    cur_len += strlen(HTTP_VER);
+    const char *p = buffer;
+    size_t value = 0;
+    for (; p < eol && isxdigit((unsigned char)*p); p++)
+    {
+        if (value > (SIZE_MAX >> 4))
+            return false;
+        value = (value << 4) | (isdigit((unsigned char)*p) ? *p - '0' : (tolower((unsigned char)*p) - 'a' + 10));
+    }
+    if (p == buffer)
+        return false;
+    // chunk extensions are allowed and ignored
+    while (*p == ' ' || *p == '\t')
+        p++;
+    if (*p != ';' && *p != '\r')
+        return false;
+    *len = eol + 1 - buffer;
+    *chunk_size = value;
+    return true;
+}
+
+test_error_code_t parse_http_response(Http_response_parser *parser, const char *buffer,
+                                      size_t size, size_t *consumed)
+{
+    size_t pos = 0;
+    *consumed = 0;
+    if (parser->state == RESPONSE_PARSE_HEADERS)
+    {
+        size_t end = parser->scan_offset;
+        bool found = find_header_end(buffer, size, &end);
+        parser->scan_offset = end;
+        if (!found)
+            return end > MAX_HEADER_SIZE ? TEST_ERROR_PARSE_FAILED : TEST_ERROR_PARSE_PARTIAL;
+        if (end > MAX_HEADER_SIZE || parse_response_head(parser, buffer, end) != TEST_ERROR_NONE)
+            return TEST_ERROR_PARSE_FAILED;
+        pos = end;
+    }
 
-    memcpy(*msg + cur_len, " ", 1);
-    cur_len += 1;
+    while (parser->state != RESPONSE_PARSE_DONE)
+    {
+        size_t avail = size - pos;
+        size_t len;
+        size_t start = pos;
+        Response_parse_state state = parser->state;
+        switch (parser->state)
+        {
+        case RESPONSE_PARSE_BODY:
+        case RESPONSE_PARSE_CHUNK_DATA:
+        case RESPONSE_PARSE_UNTIL_CLOSE:
+            if (parser->state != RESPONSE_PARSE_UNTIL_CLOSE && avail > parser->remaining)
+                avail = parser->remaining;
+            if (avail > 0 && !deliver_body(parser, buffer + pos, avail))
+                return TEST_ERROR_PARSE_FAILED;
+            pos += avail;
+            if (parser->state == RESPONSE_PARSE_UNTIL_CLOSE)
+                break;
+            parser->remaining -= avail;
+            if (parser->remaining == 0)
+                parser->state = parser->state == RESPONSE_PARSE_BODY ? RESPONSE_PARSE_DONE
+                                                                     : RESPONSE_PARSE_CHUNK_END;
+            break;
+        case RESPONSE_PARSE_CHUNK_SIZE:
+            if (!parse_chunk_size(buffer + pos, avail, &len, &parser->remaining))
+                return TEST_ERROR_PARSE_FAILED;
+            if (len == 0)
+                break;
+            pos += len;
+            parser->state = parser->remaining == 0 ? RESPONSE_PARSE_TRAILERS : RESPONSE_PARSE_CHUNK_DATA;
+            break;
+        case RESPONSE_PARSE_CHUNK_END:
+            if (avail < 2)
+                break;
+            if (buffer[pos] != '\r' || buffer[pos + 1] != '\n')
+                return TEST_ERROR_PARSE_FAILED;
+            pos += 2;
+            parser->state = RESPONSE_PARSE_CHUNK_SIZE;
+            break;
+        case RESPONSE_PARSE_TRAILERS:
+        {
+            // trailer fields are skipped, an empty line ends them
+            const char *eol = memchr(buffer + pos, '\n', avail);
+            if (eol == NULL)
+            {
+                if (avail >= MAX_HEADER_SIZE)
+                    return TEST_ERROR_PARSE_FAILED;
+                break;
+            }
+            len = eol + 1 - (buffer + pos);
+            if (len < 2 || eol[-1] != '\r')
+                return TEST_ERROR_PARSE_FAILED;
+            pos += len;
+            if (len == 2)
+                parser->state = RESPONSE_PARSE_DONE;
+            break;
+        }
+        default:
+            break;
+        }
+        // the rest of a line is still on its way
+        if (pos == start && parser->state == state)
+            break;
+    }
+    *consumed = pos;
+    return parser->state == RESPONSE_PARSE_DONE ? TEST_ERROR_NONE : TEST_ERROR_PARSE_PARTIAL;
+}
 
-    memcpy(*msg + cur_len, prepopulated_headers, prepopulated_len);
-    cur_len += prepopulated_len;
+test_error_code_t parse_http_response_eof(Http_response_parser *parser)
+{
+    if (parser->state == RESPONSE_PARSE_UNTIL_CLOSE)
+        parser->state = RESPONSE_PARSE_DONE;
+    return parser->state == RESPONSE_PARSE_DONE ? TEST_ERROR_NONE : TEST_ERROR_PARSE_FAILED;
+}
 
-    // Standard headers
-    cur_len += populate_header(*msg + cur_len, CONNECTION, strlen(CONNECTION), CONNECTION_VAL, strlen(CONNECTION_VAL));
-    cur_len += populate_header(*msg + cur_len, SERVER, strlen(SERVER), SERVER_VAL, strlen(SERVER_VAL));
-    cur_len += populate_header(*msg + cur_len, DATE, strlen(DATE), date, date_len);
-    if (content_type != NULL)
+const char *response_header(const Http_response_parser *parser, const char *buffer,
+                            const char *name, size_t *len)
+{
+    for (int i = 0; i < parser->header_count; i++)
     {
-        cur_len += populate_header(*msg + cur_len, CONTENT_TYPE, strlen(CONTENT_TYPE), content_type, content_type_len);
+        if (slice_is(buffer, parser->headers[i].name, name))
+        {
+            *len = parser->headers[i].value.len;
+            return buffer + parser->headers[i].value.off;
+        }
     }
-    if (content_length != NULL)
+    return NULL;
+}
+
+size_t format_http_date(char *buf, size_t size, time_t now)
+{
+    // HTTP dates are always in GMT (RFC 9110 IMF-fixdate)
+    struct tm now_tm;
+    gmtime_r(&now, &now_tm);
+    return strftime(buf, size, "%a, %d %b %Y %H:%M:%S GMT", &now_tm);
+}
+
+// Per thread, so workers never share or lock it
+static __thread struct
+{
+    time_t when;
+    size_t len;
+    char line[64];
+} date_cache;
+
+const char *http_date_line(size_t *len)
+{
+    time_t now = time(NULL);
+    if ((now != date_cache.when) || (date_cache.len == 0))
     {
-        cur_len += populate_header(*msg + cur_len, CONTENT_LENGTH, strlen(CONTENT_LENGTH), content_length,
-                                   content_length_len);
+        char *p = date_cache.line;
+        memcpy(p, DATE_HEADER.str, DATE_HEADER.len);
+        p += DATE_HEADER.len;
+        p += format_http_date(p, sizeof(date_cache.line) - DATE_HEADER.len - CRLF_TEMPLATE.len, now);
+        memcpy(p, CRLF_TEMPLATE.str, CRLF_TEMPLATE.len);
+        p += CRLF_TEMPLATE.len;
+        date_cache.len = p - date_cache.line;
+        date_cache.when = now;
     }
+    *len = date_cache.len;
+    return date_cache.line;
+}
+
+/**
+ * Writes n in decimal, returns the number of digits
+ */
+static size_t format_size(char *buf, size_t n)
+{
+    char digits[20];
+    size_t count = 0;
+    do
+    {
+        digits[count++] = '0' + n % 10;
+        n /= 10;
+    } while (n > 0);
+    for (size_t i = 0; i < count; i++)
+        buf[i] = digits[count - 1 - i];
+    return count;
+}
+
+#define APPEND(__p, __t)                    \
+    do                                      \
+    {                                       \
+        memcpy(__p, (__t).str, (__t).len);  \
+        __p += (__t).len;                   \
+    } while (0)
+
+size_t serialize_response_header(char *buf, Http_status status, const char *content_type,
+                                 size_t content_length, const char *last_modified, int flags)
+{
+    size_t date_len;
+    const char *date = http_date_line(&date_len);
+    size_t content_type_len = content_type == NULL ? 0 : strlen(content_type);
+    size_t last_modified_len = last_modified == NULL ? 0 : strlen(last_modified);
+
+    // worst case: the templates, 20 digits and the optional values
+    size_t max_len = STATUS_LINES[status].len + COMMON_HEADERS.len + date_len +
+                     CONTENT_TYPE_HEADER.len + content_type_len + CRLF_TEMPLATE.len +
+                     CONTENT_LENGTH_HEADER.len + 20 + CRLF_TEMPLATE.len +
+                     LAST_MODIFIED_HEADER.len + last_modified_len + CRLF_TEMPLATE.len +
+                     GZIP_HEADER.len + VARY_HEADER.len + CHUNKED_HEADER.len + CRLF_TEMPLATE.len;
+    if (max_len > RESPONSE_HEADER_MAX)
+        return 0;
+
+    char *p = buf;
+    APPEND(p, STATUS_LINES[status]);
+    if (flags & RESPONSE_CLOSE)
+        APPEND(p, CLOSE_HEADERS);
     else
+        APPEND(p, COMMON_HEADERS);
+    memcpy(p, date, date_len);
+    p += date_len;
+    if (content_type != NULL)
+    {
+        APPEND(p, CONTENT_TYPE_HEADER);
+        memcpy(p, content_type, content_type_len);
+        p += content_type_len;
+        APPEND(p, CRLF_TEMPLATE);
+    }
+    // a 304 has no body, and a Content-Length would have to be the full one
+    if (flags & RESPONSE_CHUNKED)
     {
-        cur_len += populate_header(*msg + cur_len, CONTENT_LENGTH, strlen(CONTENT_LENGTH), ZERO,
-                                   strlen(ZERO));
+        APPEND(p, CHUNKED_HEADER);
+    }
+    else if (status != HTTP_304)
+    {
+        APPEND(p, CONTENT_LENGTH_HEADER);
+        p += format_size(p, content_length);
+        APPEND(p, CRLF_TEMPLATE);
     }
     if (last_modified != NULL)
     {
-        cur_len += populate_header(*msg + cur_len, LAST_MODIFIED, strlen(CONTENT_TYPE), last_modified,
-                                   last_modified_len);
+        APPEND(p, LAST_MODIFIED_HEADER);
+        memcpy(p, last_modified, last_modified_len);
+        p += last_modified_len;
+        APPEND(p, CRLF_TEMPLATE);
     }
-    memcpy(*msg + cur_len, CRLF, strlen(CRLF));
-    cur_len += strlen(CRLF);
+    if (flags & RESPONSE_GZIP)
+        APPEND(p, GZIP_HEADER);
+    if (flags & RESPONSE_VARY)
+        APPEND(p, VARY_HEADER);
+    APPEND(p, CRLF_TEMPLATE);
+    return p - buf;
+}
 
-    if (body != NULL)
+size_t format_etag(char *buf, const struct stat *st, bool gzip)
+{
+    unsigned long long mtime = (unsigned long long)st->st_mtim.tv_sec * 1000000000ULL +
+                               st->st_mtim.tv_nsec;
+    return snprintf(buf, ETAG_MAX, "\"%llx-%llx-%llx%s\"", (unsigned long long)st->st_ino,
+                    (unsigned long long)st->st_size, mtime, gzip ? "-gz" : "");
+}
+
+size_t serialize_file_header(char *buf, Http_status status, const char *content_type,
+                             size_t content_length, const struct stat *st, int flags)
+{
+    char last_modified[64];
+    char etag[ETAG_MAX];
+    format_http_date(last_modified, sizeof(last_modified), st->st_mtime);
+    format_etag(etag, st, flags & RESPONSE_GZIP);
+    size_t len = serialize_response_header(buf, status, content_type, content_length,
+                                           last_modified, flags);
+    if (len == 0)
+        return 0;
+    return response_add_header(buf, len, "ETag: %s", etag);
+}
+
+size_t serialize_chunk_header(char *buf, size_t len)
+{
+    static const char hex[] = "0123456789abcdef";
+    char digits[2 * sizeof(size_t)];
+    size_t count = 0;
+    do
+    {
+        digits[count++] = hex[len & 0xf];
+        len >>= 4;
+    } while (len > 0);
+    for (size_t i = 0; i < count; i++)
+        buf[i] = digits[count - 1 - i];
+    memcpy(buf + count, CRLF_TEMPLATE.str, CRLF_TEMPLATE.len);
+    return count + CRLF_TEMPLATE.len;
+}
+
+size_t response_add_header(char *buf, size_t len, const char *fmt, ...)
+{
+    // headers that didn't fit in the first place stay that way
+    if (len < CRLF_TEMPLATE.len)
+        return 0;
+    // the line goes where the blank line ending the headers is now
+    size_t pos = len - CRLF_TEMPLATE.len;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf + pos, RESPONSE_HEADER_MAX - pos, fmt, ap);
+    va_end(ap);
+    if ((n < 0) || (pos + n + 2 * CRLF_TEMPLATE.len > RESPONSE_HEADER_MAX))
     {
-        memcpy(*msg + cur_len, body, body_len);
-        cur_len += body_len;
+        // leave the headers as they were
+        memcpy(buf + pos, CRLF_TEMPLATE.str, CRLF_TEMPLATE.len);
+        return 0;
     }
-    return TEST_ERROR_NONE;
+    pos += n;
+    memcpy(buf + pos, CRLF_TEMPLATE.str, CRLF_TEMPLATE.len);
+    memcpy(buf + pos + CRLF_TEMPLATE.len, CRLF_TEMPLATE.str, CRLF_TEMPLATE.len);
+    return pos + 2 * CRLF_TEMPLATE.len;
+}
+
+// Pre-rendered error responses, re-rendered when the Date line changes
+static __thread struct
+{
+    time_t when;
+    size_t len;
+    char msg[RESPONSE_HEADER_MAX];
+} error_cache[HTTP_STATUS_COUNT];
+
+const char *error_response(Http_status status, size_t *len)
+{
+    size_t date_len;
+    http_date_line(&date_len);
+    if ((error_cache[status].len == 0) || (error_cache[status].when != date_cache.when))
+    {
+        error_cache[status].len = serialize_response_header(error_cache[status].msg, status,
+                                                            NULL, 0, NULL, 0);
+        error_cache[status].when = date_cache.when;
+    }
+    *len = error_cache[status].len;
+    return error_cache[status].msg;
 }
 
-int populate_header(char *msg, char *field, const size_t field_len, char *val, const size_t val_len)
+int populate_header(char *msg, const char *field, const size_t field_len, const char *val, const size_t val_len)
 {
     memcpy(msg, field, field_len);
     memcpy(msg + field_len, val, val_len);
-    memcpy(msg + field_len + val_len, CRLF, strlen(CRLF));
-    return field_len + val_len + strlen(CRLF);
+    memcpy(msg + field_len + val_len, CRLF_TEMPLATE.str, CRLF_TEMPLATE.len);
+    return field_len + val_len + CRLF_TEMPLATE.len;
 }
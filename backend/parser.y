@@ -10,9 +10,11 @@
  */
 
 
-%{
+%code requires {
 #include "parse_http.h"
+}
 
+%{
 /* Define YACCDEBUG to enable debug messages for this lex file */
 //#define YACCDEBUG
 #define YYERROR_VERBOSE
@@ -23,39 +25,28 @@
 #define YPRINTF(...)
 #endif
 
-/* yyparse() calls yyerror() on error */
-void yyerror (const char *s);
-
-void set_parsing_options(char *buf, size_t siz, Request *parsing_request);
-
-/* yyparse() calls yylex() to get tokens */
-extern int yylex();
-
-
-/*
-** Global variables required for parsing from buffer
-** instead of stdin:
-*/
-
-/* Pointer to the buffer that contains input */
-char *parsing_buf;
-
-/* Current position in the buffer */
-int parsing_offset;
+/* The parser is pure: everything it works on hangs off the Parse_context
+  passed to yyparse(), so threads can parse at the same time */
+%}
 
-/* Buffer size */
-size_t parsing_buf_siz;
+%define api.pure full
+%parse-param {void *scanner} {Parse_context *ctx}
+%lex-param {void *scanner}
 
-/* Current parsing_request Header Struct */
-Request *parsing_request;
+%code {
+#include "log.h"
 
-%}
+/* yyparse() calls yylex() to get tokens, from the reentrant scanner in lexer.l */
+int yylex(YYSTYPE *yylval, void *scanner);
 
+/* yyparse() calls yyerror() on error */
+void yyerror(void *scanner, Parse_context *ctx, const char *s);
+}
 
-/* Various types values that we can get from lex */
+/* Every value is a slice of the buffer being parsed: tokens are the bytes
+  they matched, rules span the tokens they were built from */
 %union {
-	char str[8192];
-	int i;
+	Http_slice s;
 }
 
 %start request
@@ -98,62 +89,62 @@ Request *parsing_request;
 %token t_lws
 
 /* Type of value returned for these tokens */
-%type<i> t_uphex
-%type<i> t_lohex
-%type<i> t_upalpha
-%type<i> t_loalpha
-%type<i> t_digit
-%type<i> t_cr
-%type<i> t_lf
-%type<i> t_sp
-%type<i> t_ht
-%type<i> t_ctl
-%type<i> t_slash
-%type<i> t_dot
-%type<i> t_colon
-%type<i> t_question
-%type<i> t_asterisk
-%type<i> t_percent
-%type<i> t_plus
-%type<i> t_minus
-%type<i> t_at
-%type<i> t_semicolon
-%type<i> t_ampersand
-%type<i> t_equal
-%type<i> t_dollar
-%type<i> t_comma
-%type<i> t_mark_sep
-%type<i> t_separators
-%type<i> t_mark_token
-%type<i> t_token
-%type<i> t_text
-%type<str> t_lws
+%type<s> t_uphex
+%type<s> t_lohex
+%type<s> t_upalpha
+%type<s> t_loalpha
+%type<s> t_digit
+%type<s> t_cr
+%type<s> t_lf
+%type<s> t_sp
+%type<s> t_ht
+%type<s> t_ctl
+%type<s> t_slash
+%type<s> t_dot
+%type<s> t_colon
+%type<s> t_question
+%type<s> t_asterisk
+%type<s> t_percent
+%type<s> t_plus
+%type<s> t_minus
+%type<s> t_at
+%type<s> t_semicolon
+%type<s> t_ampersand
+%type<s> t_equal
+%type<s> t_dollar
+%type<s> t_comma
+%type<s> t_mark_sep
+%type<s> t_separators
+%type<s> t_mark_token
+%type<s> t_token
+%type<s> t_text
+%type<s> t_lws
 
 /*
  * Followed by this, you should have types defined for all the intermediate
  * rules that you will define. These are some of the intermediate rules:
  */
-%type<i> upalpha
-%type<i> loalpha
-%type<i> alpha
-%type<i> alphanum
-%type<i> ctl
-%type<i> spht
-%type<i> reserved_sep_no_slash
-%type<i> reserved_sep
-%type<i> separators
-%type<i> reserved_token
-%type<i> mark_token
-%type<i> token_char
-%type<i> text_char
-%type<i> octet
-
-%type<str> crlf
-%type<str> token
-%type<str> text
-%type<str> field_value_part
-%type<str> field_value
-%type<str> http_version
+%type<s> upalpha
+%type<s> loalpha
+%type<s> alpha
+%type<s> alphanum
+%type<s> ctl
+%type<s> spht
+%type<s> reserved_sep_no_slash
+%type<s> reserved_sep
+%type<s> separators
+%type<s> reserved_token
+%type<s> mark_token
+%type<s> token_char
+%type<s> text_char
+%type<s> octet
+
+%type<s> crlf
+%type<s> token
+%type<s> text
+%type<s> field_value_part
+%type<s> field_value
+%type<s> http_version
 
 %%
 
@@ -172,7 +163,6 @@ alpha: upalpha | loalpha {
 alphanum: alpha {
 //    printf("alphanum: %c\n", $$);
 }; | t_digit {
-    $$ = $1 + '0';
 //    printf("alphanum: %c\n", $$);
 };
 
@@ -217,112 +207,49 @@ octet: text_char | ctl {
 };
 
 crlf: t_cr t_lf {
-    $$[0] = '\r';
-    $$[1] = '\n';
-    $$[3] = 0;
+    $$.len = 2;
 //    printf("crlf\n");
 };
 
 token:
 token_char {
 	YPRINTF("token: Matched rule 1.\n");
-	snprintf($$, 8192, "%c", $1);
-//	printf("token: %s\n", $$);
 }; |
 token token_char {
 	YPRINTF("token: Matched rule 2.\n");
-	size_t len = strlen($1);
-	memcpy($$, $1, len);
-	$$[len] = $2;
-	$$[len + 1] = 0;
-    // snprintf($$, 8192, "%s%c", $1, $2);
-//    printf("token: %s\n", $$);
+	// tokens are contiguous, so the slice just grows
+	$$.len = $1.len + $2.len;
 };
 
 text:
 text_char {
 	YPRINTF("text: Matched rule 1.\n");
-	snprintf($$, 8192, "%c", $1);
-//	printf("text: %s\n", $$);
 }; |
 text text_char {
 	YPRINTF("text: Matched rule 2.\n");
-	size_t len = strlen($1);
-	memcpy($$, $1, len);
-	$$[len] = $2;
-	$$[len + 1] = 0;
-    // snprintf($$, 8192, "%s%c", $1, $2);
-//    printf("text: %s\n", $$);
+	$$.len = $1.len + $2.len;
 };
 
 field_value_part: octet {
-    $$[0] = $1;
-    $$[1] = 0;
-//    printf("octet field_value_part: %s\n", $$);
+//    printf("octet field_value_part\n");
 };| t_lws {
-//    printf("lws field_value_part: %s\n", $1);
+//    printf("lws field_value_part\n");
 };
 
 field_value: field_value_part {
-//    printf("Single field_value: %s\n", $1);
+//    printf("Single field_value\n");
 }; | field_value field_value_part {
-    size_t len = strlen($1);
-    memcpy($$, $1, len);
-    strcpy($$ + len, $2);
-//    printf("Multiple field_value: %s\n", $$);
+    $$.len = $1.len + $2.len;
+//    printf("Multiple field_value\n");
 };
 
 request_header_part: token t_colon field_value crlf {
-//    printf("request_header_part: %s:%s\n", $1, $3);
-
-	parsing_request->header_count++;
-
-	// Reallocate header size if necessary
-	if (parsing_request->header_count > parsing_request->allocated_headers) {
-	    parsing_request->allocated_headers *= 2;
-	    Request_header *headers = (Request_header *) malloc(sizeof(Request_header)*parsing_request->allocated_headers);
-    	for(int i = 0; i < parsing_request->header_count - 1; i++) {
-    	    strcpy(headers[i].header_name, parsing_request->headers[i].header_name);
-    	    strcpy(headers[i].header_value, parsing_request->headers[i].header_value);
-    	}
-
-        strcpy(headers[parsing_request->header_count - 1].header_name, $1);
-    	strcpy(headers[parsing_request->header_count - 1].header_value, $3);
-
-    	free(parsing_request->headers);
-    	parsing_request->headers = headers;
-	} else {
-	    strcpy(parsing_request->headers[parsing_request->header_count - 1].header_name, $1);
-        strcpy(parsing_request->headers[parsing_request->header_count - 1].header_value, $3);
-	}
-
-	parsing_request->status_header_size += strlen($1) + 1 + strlen($3) + 2;
+	if (!request_add_header(ctx->request, $1, $3))
+	    YYABORT;
 }; | token t_colon crlf {
-//    printf("request_header_part: %s:\n", $1);
-
-    // Reallocate header size
-	parsing_request->header_count++;
-
-	// Reallocate header size if necessary
-    if (parsing_request->header_count > parsing_request->allocated_headers) {
-        parsing_request->allocated_headers *= 2;
-        Request_header *headers = (Request_header *) malloc(sizeof(Request_header)*parsing_request->allocated_headers);
-       	for(int i = 0; i < parsing_request->header_count - 1; i++) {
-       	    strcpy(headers[i].header_name, parsing_request->headers[i].header_name);
-       	    strcpy(headers[i].header_value, parsing_request->headers[i].header_value);
-       	}
-
-        strcpy(headers[parsing_request->header_count - 1].header_name, $1);
-       	strcpy(headers[parsing_request->header_count - 1].header_value, "");
-
-       	free(parsing_request->headers);
-       	parsing_request->headers = headers;
-    } else {
-        strcpy(parsing_request->headers[parsing_request->header_count - 1].header_name, $1);
-        strcpy(parsing_request->headers[parsing_request->header_count - 1].header_value, "");
-    }
-
-	parsing_request->status_header_size += strlen($1) + 1 + 2;
+	Http_slice empty = {$3.off, 0};
+	if (!request_add_header(ctx->request, $1, empty))
+	    YYABORT;
 }
 
 request_header: request_header_part {
@@ -332,37 +259,24 @@ request_header: request_header_part {
 };
 
 http_version: token t_slash t_digit t_dot t_digit {
-    if (strcmp("HTTP", $1) == 0)
-    {
-        memcpy($$, $1, 4);
-        $$[4] = $2;
-        $$[5] = $3 + '0';
-        $$[6] = $4;
-        $$[7] = $5 + '0';
-        $$[8] = 0;
-    }
+    // another protocol parses, but leaves the version empty
+    if (($1.len == 4) && (memcmp(ctx->buf + $1.off, "HTTP", 4) == 0))
+        $$.len = $1.len + 4;
     else
-    {
-        $$[0] = 0;
-    }
-//    printf("Version: %s\n", $$);
+        $$.len = 0;
 }
 
 request_line: token t_sp text t_sp http_version crlf {
-//	printf("request_Line:\n%s %s %s\n",$1, $3,$5);
-	strcpy(parsing_request->http_method, $1);
-	strcpy(parsing_request->http_uri, $3);
-	strcpy(parsing_request->http_version, $5);
-	parsing_request->status_header_size += strlen($1) + 1 + strlen($3) + 1 + strlen($5) + 2;
+	ctx->request->method = $1;
+	ctx->request->uri = $3;
+	ctx->request->version = $5;
 }
 
 request: request_line request_header crlf {
     YPRINTF("parsing_request: Matched Success.\n");
-    parsing_request->status_header_size += 2;
     return SUCCESS;
 }; | request_line crlf {
     YPRINTF("parsing_request: Matched Success.\n");
-    parsing_request->status_header_size += 2;
     return SUCCESS;
 }
 
@@ -370,12 +284,8 @@ request: request_line request_header crlf {
 
 /* C code */
 
-void set_parsing_options(char *buf, size_t siz, Request *request)
+/* malformed requests are up to the client, they are only worth a debug line */
+void yyerror(void *scanner, Parse_context *ctx, const char *s)
 {
-    parsing_buf = buf;
-	parsing_offset = 0;
-	parsing_buf_siz = siz;
-    parsing_request = request;
+    LOG_DEBUG("%s", s);
 }
-
-void yyerror (const char *s) {fprintf (stderr, "%s\n", s);}
@@ -8,6 +8,8 @@
  * No part of the HTTP project may be copied and/or distributed
  * without the express permission of the 15-441/641 course staff.
  */
+#include "parse_http.h"
+
 /* HTTP Methods */
 const char *HEAD = "HEAD";
 const char *GET = "GET";
@@ -44,6 +46,33 @@ char *INTERNAL_SERVER_ERROR = "500 Internal Server Error\r\n";
 
 char *BAD_REQUEST = "400 Bad Request\r\n";
 
+/* Templates, their lengths are worked out by the compiler */
+#define TEMPLATE(__s) {__s, sizeof(__s) - 1}
+
+const Http_template STATUS_LINES[HTTP_STATUS_COUNT] = {
+    [HTTP_200] = TEMPLATE("HTTP/1.1 200 OK\r\n"),
+    [HTTP_206] = TEMPLATE("HTTP/1.1 206 Partial Content\r\n"),
+    [HTTP_304] = TEMPLATE("HTTP/1.1 304 Not Modified\r\n"),
+    [HTTP_400] = TEMPLATE("HTTP/1.1 400 Bad Request\r\n"),
+    [HTTP_404] = TEMPLATE("HTTP/1.1 404 Not Found\r\n"),
+    [HTTP_408] = TEMPLATE("HTTP/1.1 408 Request Timeout\r\n"),
+    [HTTP_416] = TEMPLATE("HTTP/1.1 416 Range Not Satisfiable\r\n"),
+    [HTTP_500] = TEMPLATE("HTTP/1.1 500 Internal Server Error\r\n"),
+    [HTTP_503] = TEMPLATE("HTTP/1.1 503 Service Unavailable\r\n"),
+};
+
+const Http_template COMMON_HEADERS = TEMPLATE("Connection: Keep-Alive\r\nServer: cmu/1.0\r\n");
+const Http_template CLOSE_HEADERS = TEMPLATE("Connection: close\r\nServer: cmu/1.0\r\n");
+const Http_template DATE_HEADER = TEMPLATE("Date: ");
+const Http_template CONTENT_TYPE_HEADER = TEMPLATE("Content-Type: ");
+const Http_template CONTENT_LENGTH_HEADER = TEMPLATE("Content-Length: ");
+const Http_template LAST_MODIFIED_HEADER = TEMPLATE("Last-Modified: ");
+const Http_template CRLF_TEMPLATE = TEMPLATE("\r\n");
+const Http_template GZIP_HEADER = TEMPLATE("Content-Encoding: gzip\r\n");
+const Http_template VARY_HEADER = TEMPLATE("Vary: Accept-Encoding\r\n");
+const Http_template CHUNKED_HEADER = TEMPLATE("Transfer-Encoding: chunked\r\n");
+const Http_template LAST_CHUNK = TEMPLATE("0\r\n\r\n");
+
 /* MIME TYPES */
 char *HTML_EXT = "html";
 char *HTML_MIME = "text/html";
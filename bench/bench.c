@@ -0,0 +1,322 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the HTTP course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the HTTP project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "parse_http.h"
+#include "arena.h"
+
+/* Microbenchmarks of the request path, run by "make bench".
+ *
+ * Each benchmark runs its operation in batches of growing size until a
+ * batch takes at least --time seconds, then reports that batch. malloc()
+ * and friends are wrapped at link time (-Wl,--wrap), so allocations made
+ * by the code under test are counted, not those made inside libc. */
+
+// Minimum run time of a benchmark
+#define DEFAULT_BENCH_SECS 0.5
+// Requests in the pipelined batch
+#define PIPELINE_DEPTH 16
+
+static uint64_t allocs;
+static uint64_t alloc_bytes;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *p, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+  allocs++;
+  alloc_bytes += size;
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+  allocs++;
+  alloc_bytes += n * size;
+  return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *p, size_t size)
+{
+  allocs++;
+  alloc_bytes += size;
+  return __real_realloc(p, size);
+}
+
+//State the benchmarked operations work on
+struct bench_ctx {
+  char *input;                  //!< Request bytes, a copy the parsers may write to
+  size_t input_len;
+  Request request;
+  Response response;
+  struct arena arena;
+  char *folder;                 //!< For process_http_request()
+  char out[HTTP_SIZE];
+};
+
+struct bench {
+  const char *name;
+  const char *input;            //!< Request bytes to start from, NULL for none
+  size_t (*op)(struct bench_ctx *ctx); //!< One operation, returns the bytes it handled
+};
+
+static const char SHORT_GET[] = "GET /index.html HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+
+static const char BROWSER_GET[] =
+    "GET /images/liso_header.png HTTP/1.1\r\n"
+    "Host: www.cs.cmu.edu\r\n"
+    "Connection: keep-alive\r\n"
+    "sec-ch-ua: \"Chromium\";v=\"118\", \"Google Chrome\";v=\"118\", \"Not=A?Brand\";v=\"99\"\r\n"
+    "sec-ch-ua-mobile: ?0\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) "
+    "Chrome/118.0.0.0 Safari/537.36\r\n"
+    "sec-ch-ua-platform: \"Linux\"\r\n"
+    "Accept: image/avif,image/webp,image/apng,image/svg+xml,image/*,*/*;q=0.8\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "Sec-Fetch-Mode: no-cors\r\n"
+    "Sec-Fetch-Dest: image\r\n"
+    "Referer: http://www.cs.cmu.edu/~prs/15-441-F15/index.html\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: en-US,en;q=0.9,de;q=0.8\r\n"
+    "If-None-Match: \"1f2e3d-4c5b-1697040000000000000\"\r\n"
+    "If-Modified-Since: Wed, 11 Oct 2023 16:00:00 GMT\r\n"
+    "\r\n";
+
+static char *large_get;         // Cookies filling most of MAX_HEADER_SIZE
+static char *pipelined;         // PIPELINE_DEPTH short GETs back to back
+
+static void build_inputs()
+{
+  size_t cap = MAX_HEADER_SIZE;
+  large_get = malloc(cap);
+  int len = snprintf(large_get, cap, "GET /index.html HTTP/1.1\r\nHost: 127.0.0.1\r\n");
+  for (int i = 0; len + 200 < (int)(cap - 512); i++)
+    len += snprintf(large_get + len, cap - len, "Cookie: session%d=%0150d\r\n", i, i);
+  snprintf(large_get + len, cap - len, "\r\n");
+
+  pipelined = malloc(PIPELINE_DEPTH * sizeof(SHORT_GET));
+  pipelined[0] = '\0';
+  for (int i = 0; i < PIPELINE_DEPTH; i++)
+    strcat(pipelined, SHORT_GET);
+}
+
+static size_t op_parse(struct bench_ctx *ctx)
+{
+  if (parse_http_request(ctx->input, ctx->input_len, &ctx->request, NULL) != TEST_ERROR_NONE)
+    abort();
+  return ctx->input_len;
+}
+
+/* a read holding several requests, parsed one after the other the way the
+  server does */
+static size_t op_parse_pipelined(struct bench_ctx *ctx)
+{
+  size_t off = 0;
+  while (off < ctx->input_len)
+  {
+    if (parse_http_request(ctx->input + off, ctx->input_len - off, &ctx->request, NULL) != TEST_ERROR_NONE)
+      abort();
+    off += ctx->request.status_header_size;
+  }
+  return off;
+}
+
+static size_t op_serialize_request(struct bench_ctx *ctx)
+{
+  size_t len = 0;
+  if (serialize_http_request(ctx->out, &len, &ctx->request) != TEST_ERROR_NONE)
+    abort();
+  return len;
+}
+
+/* a small file's response the way the cache stores it: headers and body in
+  one buffer */
+static size_t op_serialize_response(struct bench_ctx *ctx)
+{
+  static const char body[1024];
+  size_t len = serialize_response_header(ctx->out, HTTP_200, HTML_MIME, sizeof(body),
+                                         "Wed, 11 Oct 2023 16:00:00 GMT", RESPONSE_VARY);
+  if (len == 0)
+    abort();
+  memcpy(ctx->out + len, body, sizeof(body));
+  return len + sizeof(body);
+}
+
+static size_t op_error_response(struct bench_ctx *ctx)
+{
+  (void)ctx;
+  size_t len;
+  error_response(HTTP_404, &len);
+  return len;
+}
+
+static size_t op_serialize_header(struct bench_ctx *ctx)
+{
+  static struct stat st = {.st_ino = 1234, .st_size = 1024};
+  size_t len = serialize_file_header(ctx->out, HTTP_200, HTML_MIME, 1024, &st, RESPONSE_VARY);
+  if (len == 0)
+    abort();
+  return len;
+}
+
+static size_t op_trim(struct bench_ctx *ctx)
+{
+  static const char value[] = "   text/html; charset=utf-8 \t  ";
+  memcpy(ctx->out, value, sizeof(value));
+  trim_whitespace(ctx->out, sizeof(value) - 1);
+  return sizeof(value) - 1;
+}
+
+static size_t op_process(struct bench_ctx *ctx)
+{
+  if (process_http_request(&ctx->request, &ctx->response, ctx->folder, &ctx->arena) != TEST_ERROR_NONE)
+    abort();
+  size_t len = ctx->response.header_len + (ctx->response.body_fd >= 0 ? ctx->response.body_len : 0);
+  if (ctx->response.body_fd >= 0)
+    close(ctx->response.body_fd);
+  arena_reset(&ctx->arena);
+  return len;
+}
+
+static double now_secs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void run(FILE *report, const struct bench *b, struct bench_ctx *ctx, double min_secs,
+                const char *suffix)
+{
+  if (b->input != NULL)
+  {
+    ctx->input_len = strlen(b->input);
+    memcpy(ctx->input, b->input, ctx->input_len + 1);
+    // operations working on a parsed request get this one
+    if (parse_http_request(ctx->input, ctx->input_len, &ctx->request, NULL) != TEST_ERROR_NONE)
+    {
+      fprintf(report, "%s: input doesn't parse\n", b->name);
+      return;
+    }
+  }
+
+  uint64_t n = 1;
+  while (1)
+  {
+    uint64_t bytes = 0;
+    uint64_t allocs_before = allocs;
+    uint64_t alloc_bytes_before = alloc_bytes;
+    double start = now_secs();
+    for (uint64_t i = 0; i < n; i++)
+      bytes += b->op(ctx);
+    double elapsed = now_secs() - start;
+    if ((elapsed >= min_secs) || (n >= (1ull << 40)))
+    {
+      char name[64];
+      snprintf(name, sizeof(name), "%s%s", b->name, suffix);
+      fprintf(report, "%-36s %12llu %10.1f ns/op %8.1f MB/s %8.1f B/op %6.2f allocs/op %8.1f alloc B/op\n",
+              name, (unsigned long long)n, elapsed * 1e9 / n, bytes / elapsed / 1e6, (double)bytes / n,
+              (double)(allocs - allocs_before) / n, (double)(alloc_bytes - alloc_bytes_before) / n);
+      return;
+    }
+    // aim a bit past the target
+    double per_op = elapsed / n;
+    uint64_t next = per_op > 0 ? (uint64_t)(min_secs * 1.2 / per_op) : n * 100;
+    n = next > 100 * n ? 100 * n : next < 2 * n ? 2 * n : next;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  double min_secs = DEFAULT_BENCH_SECS;
+  const char *filter = NULL;
+  char *folder = "./cp1/test_visual";
+  int opt;
+  while ((opt = getopt(argc, argv, "t:f:w:")) != -1)
+  {
+    switch (opt)
+    {
+    case 't':
+      min_secs = atof(optarg);
+      break;
+    case 'f':
+      filter = optarg;
+      break;
+    case 'w':
+      folder = optarg;
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-t secs per benchmark] [-f name filter] [-w www folder]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // the request path only logs at debug level, which is off
+  FILE *report = stdout;
+  setvbuf(report, NULL, _IOLBF, 0);
+
+  build_inputs();
+  struct bench_ctx *ctx = calloc(1, sizeof(struct bench_ctx));
+  ctx->input = malloc(MAX_HEADER_SIZE * 2);
+  ctx->folder = folder;
+  ctx->response.body_fd = -1;
+  arena_init(&ctx->arena, ARENA_BLOCK_SIZE);
+
+  const struct bench parse_benches[] = {
+      {"parse_http_request/short", SHORT_GET, op_parse},
+      {"parse_http_request/browser", BROWSER_GET, op_parse},
+      {"parse_http_request/large", large_get, op_parse},
+      {"parse_http_request/pipelined16", pipelined, op_parse_pipelined},
+  };
+  const struct bench other_benches[] = {
+      {"serialize_http_request/short", SHORT_GET, op_serialize_request},
+      {"serialize_http_request/browser", BROWSER_GET, op_serialize_request},
+      {"serialize_response_header/1k", NULL, op_serialize_response},
+      {"error_response/404", NULL, op_error_response},
+      {"serialize_file_header", NULL, op_serialize_header},
+      {"trim_whitespace", NULL, op_trim},
+      {"process_http_request/small", SHORT_GET, op_process},
+      {"process_http_request/sendfile", "GET /liso_header.png HTTP/1.1\r\nHost: x\r\n\r\n", op_process},
+      {"process_http_request/404", "GET /missing.html HTTP/1.1\r\nHost: x\r\n\r\n", op_process},
+  };
+
+  fprintf(report, "fast parser: %s\n", fast_parse_isa());
+  const struct {
+    Parser_mode mode;
+    const char *suffix;
+  } modes[] = {{PARSER_FAST, ""}, {PARSER_BISON, " (bison)"}};
+  for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++)
+  {
+    set_parser_mode(modes[m].mode);
+    for (size_t i = 0; i < sizeof(parse_benches) / sizeof(parse_benches[0]); i++)
+      if ((filter == NULL) || (strstr(parse_benches[i].name, filter) != NULL))
+        run(report, &parse_benches[i], ctx, min_secs, modes[m].suffix);
+  }
+  set_parser_mode(PARSER_FAST);
+  for (size_t i = 0; i < sizeof(other_benches) / sizeof(other_benches[0]); i++)
+    if ((filter == NULL) || (strstr(other_benches[i].name, filter) != NULL))
+      run(report, &other_benches[i], ctx, min_secs, "");
+
+  arena_destroy(&ctx->arena);
+  free(ctx->input);
+  free(ctx);
+  fclose(report);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,88 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the HTTP course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the HTTP project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+// Clients are spread over this many independently locked stripes, a power
+// of two, so workers accepting at once rarely wait for each other
+#define ADMISSION_STRIPES 64
+// Clients tracked by one stripe, a power of two
+#define ADMISSION_STRIPE_SLOTS 256
+// Slots a client may be found in, starting at its hash
+#define ADMISSION_PROBE 8
+
+//What admission_enter() decided
+typedef enum {
+    ADMIT,                      //!< Tracked, admission_leave() when it closes
+    ADMIT_UNTRACKED,            //!< Every slot it could take is busy, let in unlimited
+    SHED_PER_IP,                //!< The client has max_per_ip connections open
+    SHED_RATE,                  //!< The client's token bucket is empty
+} Admission_verdict;
+
+//Connections and token bucket of one client address
+struct admission_client {
+    uint32_t addr;              //!< IPv4 address, network byte order, 0 if the slot is free
+    uint32_t conns;             //!< Connections open
+    uint64_t tokens;            //!< Connections it may open right away, in thousandths
+    uint64_t refilled;          //!< When tokens was last topped up, in ms
+};
+
+//One lock and the clients whose hash falls on it
+struct admission_stripe {
+    pthread_mutex_t lock;
+    struct admission_client clients[ADMISSION_STRIPE_SLOTS];
+} __attribute__((aligned(64)));
+
+//Per client address limits, shared by all workers
+struct admission {
+    uint32_t max_per_ip;        //!< Concurrent connections of one address, 0 for no limit
+    uint64_t rate;              //!< New connections per second of one address, 0 for no limit
+    uint64_t burst;             //!< Size of the token bucket, in thousandths
+    struct admission_stripe stripes[ADMISSION_STRIPES];
+};
+
+/**
+ * @brief      Create the limits
+ *
+ * @param      max_per_ip Concurrent connections of one address, 0 for no limit (input)
+ * @param      rate       New connections per second of one address, 0 for no limit (input)
+ * @param      burst      Connections an address may open at once when it has been
+ *                        quiet, at least 1 (input)
+ * @return     the limits, NULL when out of memory
+ */
+struct admission *admission_create(uint32_t max_per_ip, uint32_t rate, uint32_t burst);
+
+/**
+ * @brief      Decide whether a new connection of addr is let in, and count it
+ *             if it is. A client that is neither connected nor short of
+ *             tokens is forgotten, its slot is reused. Thread-safe.
+ *
+ * @param      adm  The limits (input)
+ * @param      addr Client IPv4 address, network byte order (input)
+ * @param      now  Current time in ms, see timer_now_ms() (input)
+ * @return     the verdict
+ */
+Admission_verdict admission_enter(struct admission *adm, uint32_t addr, uint64_t now);
+
+/**
+ * @brief      Count a connection admission_enter() returned ADMIT for as
+ *             closed. Thread-safe.
+ *
+ * @param      adm  The limits (input)
+ * @param      addr Client IPv4 address, network byte order (input)
+ */
+void admission_leave(struct admission *adm, uint32_t addr);
+
+#endif
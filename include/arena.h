@@ -0,0 +1,82 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the HTTP course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the HTTP project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Size of the blocks an arena allocates from, bigger requests get a block
+// of their own
+#define ARENA_BLOCK_SIZE 4096
+// An arena that grew beyond this gives the extra blocks back on reset, and
+// its first block too if that is bigger
+#define ARENA_KEEP_BYTES (64 * 1024)
+
+//Chunk of memory an arena hands out pieces of
+struct arena_block {
+    struct arena_block *next;   //!< Next block, reused before a new one is made
+    size_t size;                //!< Bytes in data
+    size_t used;                //!< Bytes of data handed out
+    char data[];
+};
+
+//Bump allocator: allocations are never freed one by one, arena_reset()
+//drops them all at once
+struct arena {
+    struct arena_block *first;  //!< First block, NULL until the first allocation
+    struct arena_block *current; //!< Block allocations are taken from
+    size_t block_size;          //!< Size of regular blocks
+    size_t total;               //!< Bytes held in all blocks
+};
+
+/**
+ * @brief      Set up an empty arena, nothing is allocated until it is used
+ *
+ * @param      arena      The arena (output)
+ * @param      block_size Size of the blocks it allocates (input)
+ */
+void arena_init(struct arena *arena, size_t block_size);
+
+/**
+ * @brief      Allocate from the arena, aligned for any type
+ *
+ * @param      arena The arena (input)
+ * @param      size  Bytes wanted (input)
+ * @return     the memory, valid until the next arena_reset(), NULL when out of memory
+ */
+void *arena_alloc(struct arena *arena, size_t size);
+
+/**
+ * @brief      Copy a string into the arena
+ *
+ * @param      arena The arena (input)
+ * @param      str   The string (input)
+ * @return     the copy, NULL when out of memory
+ */
+char *arena_strdup(struct arena *arena, const char *str);
+
+/**
+ * @brief      Release everything allocated from the arena at once, keeping
+ *             its blocks for reuse. O(1) unless the arena has grown beyond
+ *             ARENA_KEEP_BYTES.
+ *
+ * @param      arena The arena (input)
+ */
+void arena_reset(struct arena *arena);
+
+/**
+ * @brief      Free all blocks of the arena
+ *
+ * @param      arena The arena (input)
+ */
+void arena_destroy(struct arena *arena);
+
+#endif
@@ -0,0 +1,50 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the HTTP course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the HTTP project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#ifndef DIR_LISTING_H
+#define DIR_LISTING_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+// Smallest buffer dir_listing_read() is guaranteed to make progress with
+#define DIR_LISTING_MIN_BUF 8192
+
+//HTML index of a directory, generated while it is read
+struct dir_listing;
+
+/**
+ * @brief      Start listing a directory
+ *
+ * @param      path The directory (input)
+ * @param      uri  The URI it was requested by, for the title (input)
+ * @return     the listing, NULL if the directory can't be opened
+ */
+struct dir_listing *dir_listing_open(const char *path, const char *uri);
+
+/**
+ * @brief      Generate the next piece of the page. Entries are written in
+ *             directory order, as many as fit.
+ *
+ * @param      listing The listing, a struct dir_listing (input)
+ * @param      buf     The buffer (output)
+ * @param      cap     Its size, at least DIR_LISTING_MIN_BUF (input)
+ * @return     the bytes written, 0 once the page is complete
+ */
+ssize_t dir_listing_read(void *listing, char *buf, size_t cap);
+
+/**
+ * @brief      Close the directory and free the listing
+ *
+ * @param      listing The listing, a struct dir_listing (input)
+ */
+void dir_listing_close(void *listing);
+
+#endif
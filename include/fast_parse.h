@@ -0,0 +1,65 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the HTTP course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the HTTP project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#ifndef FAST_PARSE_H
+#define FAST_PARSE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "test_error.h"
+
+// Requests with more headers than this are rejected by the fast parser
+#define FAST_PARSE_MAX_HEADERS 64
+
+//Part of a buffer, as an offset and a length
+typedef struct {
+    uint32_t off;
+    uint32_t len;
+} Http_slice;
+
+//Header field, untrimmed
+typedef struct {
+    Http_slice name;
+    Http_slice value;
+} Http_header_slice;
+
+//HTTP Request as slices of the buffer it was parsed from
+typedef struct {
+    Http_slice method;          //!< Request method
+    Http_slice uri;             //!< Request target
+    Http_slice version;         //!< "HTTP/x.y", empty if the request line had another protocol
+    Http_header_slice headers[FAST_PARSE_MAX_HEADERS]; //!< Header fields in order
+    int header_count;           //!< Number of headers
+    size_t header_size;         //!< Size of the request line and headers, final CRLF included
+} Request_view;
+
+/**
+ * @brief      Parse the request line and headers of a HTTP/1.x request
+ *             without copying or allocating
+ *
+ * Hot loops use AVX2 or SSE4.2 when the CPU has them and fall back to
+ * plain C otherwise.
+ *
+ * @param      buffer The buffer (input)
+ * @param      size   The size of the buffer (input)
+ * @param      view   The request (output)
+ * @return     TEST_ERROR_PARSE_PARTIAL until buffer holds all headers
+ */
+test_error_code_t parse_request_view(const char *buffer, size_t size, Request_view *view);
+
+/**
+ * @brief      Which vector code parse_request_view() runs on this CPU
+ *
+ * @return     "avx2", "sse4.2" or "scalar"
+ */
+const char *fast_parse_isa();
+
+#endif
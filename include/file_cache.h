@@ -0,0 +1,121 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the HTTP course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the HTTP project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// Cached files are checked against the file system at most this often
+#define CACHE_REVALIDATE_SECS 1
+
+//A fully serialized 200 response for one file
+struct cache_entry {
+    char *key;                  //!< Request path the entry is found by
+    char *path;                 //!< File the response was built from
+    char *blob;                 //!< Status line, headers and body
+    size_t blob_len;            //!< Length of blob
+    size_t date_off;            //!< Offset of the Date header line in blob
+    size_t date_len;            //!< Length of the Date header line, CRLF included
+    size_t etag_off;            //!< Offset of the ETag value in blob
+    size_t etag_len;            //!< Length of the ETag value, 0 if there is none
+    struct timespec mtime;      //!< Modification time of the file when cached
+    off_t size;                 //!< Size of the file when cached
+    ino_t ino;                  //!< Inode of the file when cached
+    time_t validated_at;        //!< Last time the file was checked
+    size_t charge;              //!< Bytes accounted against the cache capacity
+    int refs;                   //!< References held by the cache and by senders
+    struct cache_entry *hnext;  //!< Next entry in the hash bucket
+    struct cache_entry *prev;   //!< Neighbour towards the most recently used end
+    struct cache_entry *next;   //!< Neighbour towards the least recently used end
+};
+
+//Bounded LRU cache of responses, not thread-safe: one per worker
+struct file_cache {
+    struct cache_entry **buckets; //!< Hash table keyed by request path
+    size_t n_buckets;             //!< Number of buckets, a power of two
+    size_t n_entries;             //!< Number of cached entries
+    size_t used;                  //!< Bytes charged by all entries
+    size_t capacity;              //!< Upper bound for used
+    size_t max_entry;             //!< Largest blob that is cached
+    struct cache_entry *head;     //!< Most recently used entry
+    struct cache_entry *tail;     //!< Least recently used entry
+    size_t hits;                  //!< Lookups answered from the cache, stored
+                                  //!< atomically for the stats of other threads
+    size_t misses;                //!< Lookups that were not, the same
+};
+
+/**
+ * @brief      Create an empty cache
+ *
+ * @param      capacity Bytes the cache may hold, 0 disables caching (input)
+ * @return     the cache, NULL when out of memory
+ */
+struct file_cache *file_cache_create(size_t capacity);
+
+/**
+ * @brief      Find the response cached for a request path
+ *
+ * The backing file is stat()ed only when the entry was last validated at
+ * least CACHE_REVALIDATE_SECS ago, so most hits make no system calls. An
+ * entry whose file changed is dropped and reported as a miss.
+ *
+ * @param      cache The cache (input)
+ * @param      key   The request path (input)
+ * @param      now   The current time (input)
+ * @return     the entry with a reference taken for the caller, or NULL
+ */
+struct cache_entry *file_cache_lookup(struct file_cache *cache, const char *key, time_t now);
+
+/**
+ * @brief      Whether a response of blob_len bytes would be small enough
+ *             to cache
+ *
+ * @param      cache    The cache (input)
+ * @param      key      The request path (input)
+ * @param      path     The file the response is built from (input)
+ * @param      blob_len The length of the response (input)
+ * @return     false if file_cache_insert() would turn it down for its size
+ */
+bool file_cache_fits(const struct file_cache *cache, const char *key, const char *path,
+                     size_t blob_len);
+
+/**
+ * @brief      Cache a serialized response, evicting the least recently used
+ *             entries to make room
+ *
+ * On success the cache takes ownership of blob, otherwise it stays with the
+ * caller.
+ *
+ * @param      cache    The cache (input)
+ * @param      key      The request path (input)
+ * @param      path     The file the response was built from (input)
+ * @param      st       The file's stat() at the time it was read (input)
+ * @param      blob     The serialized response (input)
+ * @param      blob_len The length of blob (input)
+ * @param      now      The current time (input)
+ * @return     the entry with a reference taken for the caller, or NULL if
+ *             it could not be cached
+ */
+struct cache_entry *file_cache_insert(struct file_cache *cache, const char *key, const char *path,
+                                      const struct stat *st, char *blob, size_t blob_len, time_t now);
+
+/**
+ * @brief      Drop a reference returned by lookup or insert
+ *
+ * @param      entry The entry (input)
+ */
+void cache_entry_release(struct cache_entry *entry);
+
+#endif
@@ -0,0 +1,35 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the HTTP course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the HTTP project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#ifndef GZIP_H
+#define GZIP_H
+
+#include <stddef.h>
+
+// Level compressed variants are made at, they are made once and cached
+#define GZIP_LEVEL 9
+// Files bigger than this are not compressed on the fly
+#define GZIP_MAX_SIZE (8 * 1024 * 1024)
+
+/**
+ * @brief      Compress a buffer into the gzip format
+ *
+ * @param      data    The data (input)
+ * @param      len     The length of data (input)
+ * @param      reserve Bytes to leave free in front of the output, for the
+ *                     response headers (input)
+ * @param      out_len The length of the compressed data, reserve not
+ *                     included (output)
+ * @return     a malloc()ed buffer with the compressed data at offset
+ *             reserve, NULL on failure
+ */
+char *gzip_compress(const char *data, size_t len, size_t reserve, size_t *out_len);
+
+#endif
@@ -0,0 +1,83 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the HTTP course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the HTTP project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Values below 2^HISTOGRAM_SUB_BITS are counted exactly, larger ones with
+// that many significant bits, under 0.1% error like a 3-digit HDR histogram
+#define HISTOGRAM_SUB_BITS 11
+// Values are clamped to 2^HISTOGRAM_MAX_BITS - 1, about 4.8 hours in ns
+#define HISTOGRAM_MAX_BITS 44
+
+//Log-linear histogram of latencies with a single writer. Other threads may
+//histogram_merge() it while it is written to.
+struct histogram {
+    uint64_t *counts;           //!< Count of each bucket
+    uint64_t total;             //!< Values recorded
+    uint64_t min;               //!< Smallest value recorded
+    uint64_t max;               //!< Largest value recorded, before clamping
+    double sum;                 //!< Sum of the values, for the mean
+};
+
+/**
+ * @brief      Allocate an empty histogram
+ *
+ * @param      hist The histogram (output)
+ * @return     false when out of memory
+ */
+bool histogram_init(struct histogram *hist);
+
+/**
+ * @brief      Count a value
+ *
+ * @param      hist  The histogram (input/output)
+ * @param      value The value, e.g. in ns (input)
+ * @param      count How many times to count it (input)
+ */
+void histogram_record(struct histogram *hist, uint64_t value, uint64_t count);
+
+/**
+ * @brief      Add the counts of another histogram
+ *
+ * @param      hist  The histogram (input/output)
+ * @param      other The histogram to add (input)
+ */
+void histogram_merge(struct histogram *hist, const struct histogram *other);
+
+/**
+ * @brief      The value below which a fraction of the recorded values fall,
+ *             the upper end of the bucket it is in
+ *
+ * @param      hist     The histogram (input)
+ * @param      quantile From 0 to 1, e.g. 0.999 (input)
+ * @return     the value, 0 if nothing was recorded
+ */
+uint64_t histogram_quantile(const struct histogram *hist, double quantile);
+
+/**
+ * @brief      Empty the histogram, keeping its counts for reuse. Only
+ *             the writer may call this.
+ *
+ * @param      hist The histogram (input/output)
+ */
+void histogram_reset(struct histogram *hist);
+
+/**
+ * @brief      Free the counts
+ *
+ * @param      hist The histogram (input)
+ */
+void histogram_destroy(struct histogram *hist);
+
+#endif
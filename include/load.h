@@ -0,0 +1,27 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the HTTP course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the HTTP project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#ifndef LOAD_H
+#define LOAD_H
+
+/**
+ * @brief      The client's load generator, "client load [options] <server-ip>"
+ *
+ * Keeps connections busy with requests drawn from a corpus for a fixed
+ * time, either as fast as responses come back or at a constant rate, and
+ * reports throughput and a latency histogram.
+ *
+ * @param      argc The argument count, argv[0] being "load" (input)
+ * @param      argv The arguments (input)
+ * @return     the exit status
+ */
+int load_main(int argc, char *argv[]);
+
+#endif
@@ -0,0 +1,103 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the HTTP course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the HTTP project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Log levels, least severe first
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+
+// Calls below this level are compiled out, -DLOG_MIN_LEVEL=1 drops every
+// LOG_DEBUG() from the binary
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+// Bytes of the ring of each logging thread, a power of two
+#define LOG_RING_SIZE (256 * 1024)
+// Largest record, longer string arguments are cut short
+#define LOG_RECORD_MAX 1024
+// Longest formatted line
+#define LOG_LINE_MAX 2048
+// How long the formatter sleeps when every ring is empty
+#define LOG_IDLE_NS (2 * 1000 * 1000)
+
+//Least level that is logged. Set it before any thread logs.
+extern int log_level;
+//Whether log_access() records go anywhere, set by log_start()
+extern bool log_access_enabled;
+
+#define LOG_ENABLED(level) (((level) >= LOG_MIN_LEVEL) && ((level) >= log_level))
+#define LOG_AT(level, ...)              \
+    do                                  \
+    {                                   \
+        if (LOG_ENABLED(level))         \
+            log_write(level, __VA_ARGS__); \
+    } while (0)
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+/**
+ * @brief      Level called name
+ *
+ * @param      name debug, info, warn or error (input)
+ * @return     the level, -1 if there is none by that name
+ */
+int log_parse_level(const char *name);
+
+/**
+ * @brief      Log a printf()-style message, use the LOG_ macros rather than
+ *             calling this. The arguments are copied into a binary record
+ *             on the calling thread's ring and formatted later by the log
+ *             thread, so fmt has to be a string literal. Records that find
+ *             the ring full are dropped and counted. Before log_start() the
+ *             line is written to stderr right away.
+ *
+ * @param      level Level of the message (input)
+ * @param      fmt   Format, without the trailing newline (input)
+ */
+void log_write(int level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief      Log a response in the layout of the Common Log Format, if
+ *             log_access_enabled. Unlike CLF's size field, which counts
+ *             the body bytes sent, bytes is the whole response as queued:
+ *             status line, headers and chunk framing included, whether or
+ *             not the client ends up reading it all.
+ *
+ * @param      addr         Client IPv4 address, network byte order (input)
+ * @param      request_line Request line, NULL if it could not be parsed (input)
+ * @param      line_len     Length of request_line (input)
+ * @param      status       Status code sent (input)
+ * @param      bytes        Bytes of the response queued, headers included (input)
+ */
+void log_access(uint32_t addr, const char *request_line, size_t line_len, int status,
+                size_t bytes);
+
+/**
+ * @brief      Start the thread that formats the records of all threads
+ *
+ * @param      out    Where messages go (input)
+ * @param      access Where the access log goes, NULL for none (input)
+ * @return     false if the thread could not be started
+ */
+bool log_start(FILE *out, FILE *access);
+
+#endif
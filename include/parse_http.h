@@ -18,12 +18,17 @@
 #include <ctype.h>
 #include <string.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <time.h>
 
 #include "test_error.h"
+#include "fast_parse.h"
+#include "arena.h"
 
 #define SUCCESS 0
 #define HTTP_SIZE 4096
+// Largest request line plus headers we accept
+#define MAX_HEADER_SIZE 8192
 
 /* HTTP Methods */
 extern const char *HEAD, *GET, *POST;
@@ -38,35 +43,126 @@ extern char *CRLF, *CONNECTION, *CONNECTION_VAL, *SERVER, *SERVER_VAL,
 /* Responses */
 extern char *HTTP_VER, *OK, *NOT_FOUND, *SERVICE_UNAVAILABLE, *INTERNAL_SERVER_ERROR, *BAD_REQUEST;
 
+//Byte template with its length worked out at compile time
+typedef struct {
+    const char *str;
+    size_t len;
+} Http_template;
+
+//Statuses the server responds with
+typedef enum {
+    HTTP_200,
+    HTTP_206,
+    HTTP_304,
+    HTTP_400,
+    HTTP_404,
+    HTTP_408,
+    HTTP_416,
+    HTTP_500,
+    HTTP_503,
+    HTTP_STATUS_COUNT
+} Http_status;
+
+/* Response templates */
+extern const Http_template STATUS_LINES[HTTP_STATUS_COUNT];
+extern const Http_template COMMON_HEADERS, CLOSE_HEADERS, DATE_HEADER, CONTENT_TYPE_HEADER,
+    CONTENT_LENGTH_HEADER, LAST_MODIFIED_HEADER, CRLF_TEMPLATE, GZIP_HEADER, VARY_HEADER,
+    CHUNKED_HEADER, LAST_CHUNK;
+
+// Optional headers of serialize_response_header()
+#define RESPONSE_GZIP 0x1       //!< Content-Encoding: gzip
+#define RESPONSE_VARY 0x2       //!< Vary: Accept-Encoding, the body depends on it
+#define RESPONSE_CHUNKED 0x4    //!< Transfer-Encoding: chunked instead of Content-Length
+#define RESPONSE_CLOSE 0x8      //!< Connection: close instead of Keep-Alive
+
+// Room for the size line of a chunk, in hex with its CRLF
+#define CHUNK_HEADER_MAX (2 * sizeof(size_t) + 2)
+
+// Room for the headers serialize_response_header() writes
+#define RESPONSE_HEADER_MAX 512
+
 /* MIME TYPES */
 extern char *HTML_EXT, *HTML_MIME, *CSS_EXT, *CSS_MIME, *PNG_EXT, *PNG_MIME,
     *JPG_EXT, *JPG_MIME, *GIF_EXT, *GIF_MIME, *OCTET_MIME;
 
-//Header field
-typedef struct {
-	char header_name[4096];
-	char header_value[4096];
-} Request_header;
+// Requests with more headers than this are rejected
+#define MAX_REQUEST_HEADERS FAST_PARSE_MAX_HEADERS
+
+//Headers the server looks at, found once while parsing
+typedef enum {
+    HEADER_HOST,
+    HEADER_CONTENT_LENGTH,
+    HEADER_CONNECTION,
+    HEADER_IF_NONE_MATCH,
+    HEADER_RANGE,
+    HEADER_ACCEPT_ENCODING,
+    HEADER_IF_RANGE,
+    HEADER_IF_MODIFIED_SINCE,
+    HEADER_KNOWN_COUNT
+} Http_header_id;
 
 //HTTP Request Header
 typedef struct {
-    char http_version[50];      //!< HTTP version, should be 1.1 in this project
-    char http_method[50];       //!< HTTP method, could be GET, HEAD, or POSt in this project
+    char http_version[16];      //!< HTTP version, should be 1.1 in this project
+    char http_method[16];       //!< HTTP method, could be GET, HEAD, or POSt in this project
     char http_uri[4096];        //!< HTTP URI, could be /index.html, /index.css, etc.
-    char host[40];              //!< Host name, should be the IP address,
-    Request_header *headers;    //!< HTTP headers, could be Content-Length, Connection, etc.
+    const char *buf;            //!< Buffer the slices point into
+    Http_slice method;          //!< Slices of the request line
+    Http_slice uri;
+    Http_slice version;
+    Http_header_slice headers[MAX_REQUEST_HEADERS]; //!< HTTP headers, whitespace trimmed
     int header_count;           //!< Number of headers
-    size_t allocated_headers;   //!< Number of headers allocated
+    int8_t known[HEADER_KNOWN_COUNT]; //!< Index in headers of each well-known header, -1 if absent
     size_t status_header_size;  //!< Size of the status line and headers
-    char *body;                 //!< HTTP body, could be the content of the file
+    size_t content_length;      //!< Content-Length, 0 if absent
     bool valid;                 //!< Whether the request is valid
-    int body_length;             //!< Request body_length
 } Request;
 
-// functions decalred in parser.y
-int yyparse();
-void set_parsing_options(char *buf, size_t i, Request *request);
-void yyrestart();
+// Files at least this big are sent with sendfile() instead of being read
+// into the response
+#define SENDFILE_MIN_SIZE (16 * 1024)
+// Served for requests naming a directory
+#define INDEX_FILE "/index.html"
+
+//HTTP Response ready to be sent
+typedef struct {
+    Http_status status;         //!< Status of the response
+    char *header;               //!< Status line, headers and in-memory body
+    size_t header_len;          //!< Length of header
+    char head[RESPONSE_HEADER_MAX]; //!< Storage header may point to
+    int body_fd;                //!< File holding the rest of the body, -1 if none
+    off_t body_offset;          //!< Where the body starts in body_fd
+    size_t body_len;            //!< Bytes of body_fd to send
+    char *path;                 //!< File served, NULL for error responses
+    struct stat file_stat;      //!< fstat() of path when it was opened
+} Response;
+
+//Which parser parse_http_request() runs
+typedef enum {
+    PARSER_FAST,                //!< The hand-written parser in fast_parse.c
+    PARSER_BISON,               //!< The flex/bison grammar, the reference
+    PARSER_DIFF                 //!< Both, reporting disagreements to stderr
+} Parser_mode;
+
+//State of one flex/bison parse, reused from request to request
+typedef struct {
+    void *scanner;              //!< Reentrant flex scanner, made by parse_context_init()
+    char *buf;                  //!< The buffer to read the data from
+    size_t size;                //!< Size of the buffer
+    size_t offset;              //!< Current offset in the buffer
+    size_t pos;                 //!< Offset of the next token
+    Request *request;           //!< Request being filled in
+} Parse_context;
+
+// functions declared in parser.y and lexer.l
+int yyparse(void *scanner, Parse_context *ctx);
+int parse_context_init(Parse_context *ctx);
+void parse_context_destroy(Parse_context *ctx);
+/**
+ * @brief      Point the scanner at a new buffer, dropping whatever it read
+ *             ahead from the last one
+ */
+void parse_context_reset(Parse_context *ctx, char *buf, size_t size, Request *request);
 
 /**
  * @brief Remove starting and trailing whitespaces from a string. Overwrites
@@ -77,7 +173,7 @@ void yyrestart();
  */
 void trim_whitespace(char *input, size_t length);
 void to_lower(char *str, size_t str_len);
-int populate_header(char *msg, char *field, const size_t field_len, char *val, const size_t val_len);
+int populate_header(char *msg, const char *field, const size_t field_len, const char *val, const size_t val_len);
 
 /**
  * @brief      Serialize a HTTP request from the Request struct to a buffer
@@ -92,33 +188,335 @@ test_error_code_t serialize_http_request(char *buffer, size_t* size, Request *re
 
 /**
  * @brief      Parse a HTTP request from a buffer to a Request struct
+ *
+ * The buffer may hold a partial request. On TEST_ERROR_PARSE_PARTIAL,
+ * scan_offset records how far the end-of-headers scan got, so calling again
+ * once more bytes were appended to the same buffer does not rescan them.
  * 
- * @param      buffer  The buffer (input)
- * @param      size    The size of the buffer (input)
- * @param      request The request (output)
+ * @param      buffer      The buffer (input)
+ * @param      size        The size of the buffer (input)
+ * @param      request     The request (output)
+ * @param      scan_offset Where to resume scanning, 0 for a new request, may be NULL (input/output)
  * @return     the error code
  */
-test_error_code_t parse_http_request(char *buffer, size_t size, Request * request);
+test_error_code_t parse_http_request(char *buffer, size_t size, Request * request, size_t *scan_offset);
 
+// Responses with more headers than this are rejected
+#define MAX_RESPONSE_HEADERS 64
+
+//Where parse_http_response() is in a response
+typedef enum {
+    RESPONSE_PARSE_HEADERS,     //!< Status line and headers
+    RESPONSE_PARSE_BODY,        //!< Body of known length, remaining bytes left
+    RESPONSE_PARSE_CHUNK_SIZE,  //!< Size line of the next chunk
+    RESPONSE_PARSE_CHUNK_DATA,  //!< Data of a chunk, remaining bytes left
+    RESPONSE_PARSE_CHUNK_END,   //!< CRLF after the data of a chunk
+    RESPONSE_PARSE_TRAILERS,    //!< Trailer fields after the last chunk
+    RESPONSE_PARSE_UNTIL_CLOSE, //!< Body without a length, ends with the connection
+    RESPONSE_PARSE_DONE         //!< Complete
+} Response_parse_state;
 
 /**
- * @brief      Serialize a HTTP response from the Request struct to a buffer
- * 
- * @param      msg                  The message (output)
- * @param      len                  The length of the message (output)
- * @param      prepopulated_headers The prepopulated headers (input)
- * @param      content_type         The content type (input)
- * @param      content_length       The content length (input)
- * @param      last_modified        The last modified time (input)
- * @param      body_len             The HTTP body length (input)
- * @param      body                 The HTTP body (input)
+ * @brief      Receives the body of a response as it is parsed
+ *
+ * @param      user The user pointer of the parser (input)
+ * @param      data Body bytes, pointing into the caller's buffer (input)
+ * @param      len  The number of bytes (input)
+ * @return     false to fail the parse
+ */
+typedef bool (*Response_body_fn)(void *user, const char *data, size_t len);
+
+//HTTP Response being parsed, one at a time off a connection
+typedef struct {
+    Response_parse_state state; //!< What comes next
+    bool head;                  //!< Answer to a HEAD request, which has no body (input)
+    int body_fd;                //!< Body bytes are written here, -1 for none (input)
+    Response_body_fn on_body;   //!< Body bytes are handed here, may be NULL (input)
+    void *user;                 //!< Passed to on_body (input)
+    int status;                 //!< Status code
+    Http_header_slice headers[MAX_RESPONSE_HEADERS]; //!< Header fields, whitespace trimmed
+    int header_count;           //!< Number of headers
+    size_t header_size;         //!< Size of the status line and headers
+    bool chunked;               //!< Transfer-Encoding: chunked
+    bool keep_alive;            //!< The connection stays open after this response
+    size_t content_length;      //!< Content-Length, 0 if absent
+    size_t remaining;           //!< Bytes left in the body or the current chunk
+    size_t body_len;            //!< Body bytes delivered so far
+    size_t scan_offset;         //!< Where the search for the end of the headers resumes
+} Http_response_parser;
+
+/**
+ * @brief      Get a parser ready for the next response on a connection. The
+ *             input fields are kept.
+ *
+ * @param      parser The parser (output)
+ */
+void response_parser_reset(Http_response_parser *parser);
+
+/**
+ * @brief      Parse a HTTP/1.x response as its bytes arrive
+ *
+ * The buffer holds what was received and not consumed yet. Call again
+ * with the unconsumed bytes plus whatever arrived since. Body bytes are
+ * not copied: they are written to body_fd and handed to on_body straight
+ * from buffer and consumed, so the buffer only ever holds headers, chunk
+ * size lines and the tail of a read. The header slices are offsets into
+ * buffer as passed to the call that parsed the headers.
+ *
+ * On TEST_ERROR_NONE the bytes after *consumed belong to the next
+ * pipelined response: reset the parser and parse them.
+ *
+ * @param      parser   The parser (input/output)
+ * @param      buffer   The buffer (input)
+ * @param      size     The size of the buffer (input)
+ * @param      consumed How many bytes of buffer the caller can drop (output)
+ * @return     TEST_ERROR_PARSE_PARTIAL until the whole response was parsed,
+ *             TEST_ERROR_PARSE_FAILED for malformed responses and failed writes
+ */
+test_error_code_t parse_http_response(Http_response_parser *parser, const char *buffer,
+                                      size_t size, size_t *consumed);
+
+/**
+ * @brief      Tell the parser the connection was closed
+ *
+ * @param      parser The parser (input/output)
+ * @return     TEST_ERROR_NONE if that completes the response, because its
+ *             body runs until the connection closes
+ */
+test_error_code_t parse_http_response_eof(Http_response_parser *parser);
+
+/**
+ * @brief      Find a header of a parsed response
+ *
+ * @param      parser The parser (input)
+ * @param      buffer The buffer the headers were parsed from (input)
+ * @param      name   The field name, any case (input)
+ * @param      len    The length of the trimmed value (output)
+ * @return     the value, not NUL terminated, NULL if there is no such header
+ */
+const char *response_header(const Http_response_parser *parser, const char *buffer,
+                            const char *name, size_t *len);
+
+/**
+ * @brief      Record a header while parsing, trimming the value and filling
+ *             in the slot of a well-known header
+ *
+ * @param      request The request (input/output)
+ * @param      name    The field name (input)
+ * @param      value   The field value (input)
+ * @return     false if the request has too many headers
+ */
+bool request_add_header(Request *request, Http_slice name, Http_slice value);
+
+/**
+ * @brief      The value of a well-known header, not NUL terminated
+ *
+ * @param      request The request (input)
+ * @param      id      The header (input)
+ * @param      len     The length of the value (output)
+ * @return     the value, NULL if the request doesn't have the header
+ */
+const char *request_header(const Request *request, Http_header_id id, size_t *len);
+
+/**
+ * @brief      Whether a well-known header is present with the given value,
+ *             ignoring case
+ */
+bool request_header_is(const Request *request, Http_header_id id, const char *value);
+
+/**
+ * @brief      Whether Accept-Encoding allows a content coding, explicitly or
+ *             through "*", and doesn't give it q=0
+ *
+ * @param      request The request (input)
+ * @param      coding  The content coding, e.g. "gzip" (input)
+ * @return     true if the coding may be used
+ */
+bool request_accepts_encoding(const Request *request, const char *coding);
+
+// Requests asking for more ranges than this get the whole file
+#define MAX_RANGES 16
+
+//A byte range of a file, resolved against its size
+typedef struct {
+    off_t start;                //!< First byte
+    off_t len;                  //!< Number of bytes, at least 1
+} Http_range;
+
+//Outcome of looking at a Range header
+typedef enum {
+    RANGE_NONE,                 //!< No usable Range header, send the whole file
+    RANGE_OK,                   //!< Send the ranges
+    RANGE_UNSATISFIABLE,        //!< None of the ranges overlaps the file, 416
+} Range_result;
+
+/**
+ * @brief      Resolve the "bytes=" ranges of the Range header against a file
+ *
+ * Open-ended ("500-") and suffix ("-500") ranges are supported. Ranges
+ * starting past the end are dropped, malformed headers and other units are
+ * ignored as RFC 9110 asks.
+ *
+ * @param      request The request (input)
+ * @param      size    The size of the file (input)
+ * @param      ranges  MAX_RANGES ranges, in the order they were asked for (output)
+ * @param      count   The number of ranges (output)
+ * @return     whether and how to answer with ranges
+ */
+Range_result request_ranges(const Request *request, off_t size, Http_range *ranges, int *count);
+
+/**
+ * @brief      Whether an ETag is in the If-None-Match list, or the list is
+ *             "*". Weak comparison, as RFC 9110 asks for If-None-Match.
+ *
+ * @param      request The request (input)
+ * @param      etag    The ETag, quotes included (input)
+ * @param      len     The length of etag (input)
+ * @return     true if the client's copy matches
+ */
+bool request_etag_matches(const Request *request, const char *etag, size_t len);
+
+/**
+ * @brief      Parse an HTTP date (IMF-fixdate, the only format we send)
+ *
+ * @param      str  The date (input)
+ * @param      len  The length of str (input)
+ * @param      when The time (output)
+ * @return     false if it isn't a valid date
+ */
+bool parse_http_date(const char *str, size_t len, time_t *when);
+
+/**
+ * @brief      Whether a file is worth compressing, going by its extension
+ *
+ * @param      path The file (input)
+ * @return     true for text types like HTML, CSS and JavaScript
+ */
+bool is_compressible(const char *path);
+
+/**
+ * @brief      Select the parser behind parse_http_request(), PARSER_FAST
+ *             unless set
+ *
+ * @param      mode The parser (input)
+ */
+void set_parser_mode(Parser_mode mode);
+Parser_mode get_parser_mode();
+
+/**
+ * @brief      The current "Date: ...\r\n" header line
+ *
+ * Formatted at most once per second per thread, the returned buffer is
+ * thread-local and stays valid.
+ *
+ * @param      len  The length of the line (output)
+ * @return     the line
+ */
+const char *http_date_line(size_t *len);
+
+/**
+ * @brief      Serialize a response's status line and headers, without
+ *             allocating
+ *
+ * @param      buf            The buffer, RESPONSE_HEADER_MAX bytes (output)
+ * @param      status         The status (input)
+ * @param      content_type   The content type, may be NULL (input)
+ * @param      content_length The content length (input)
+ * @param      last_modified  The last modified time, may be NULL (input)
+ * @param      flags          RESPONSE_GZIP and RESPONSE_VARY (input)
+ * @return     the length of the headers, 0 if they don't fit
  */
-test_error_code_t serialize_http_response(char **msg, size_t *len, 
-    const char *prepopulated_headers, char *content_type, char *content_length, 
-    char *last_modified, size_t body_len, char *body);
+size_t serialize_response_header(char *buf, Http_status status, const char *content_type,
+                                 size_t content_length, const char *last_modified, int flags);
 
-char *process_http_request(Request *request, size_t *len, char *base_folder);
+// Room for an ETag, quotes included
+#define ETAG_MAX 64
+
+/**
+ * @brief      The strong ETag of a file, from its inode, size and
+ *             modification time
+ *
+ * @param      buf  The buffer, ETAG_MAX bytes (output)
+ * @param      st   The file's stat() (input)
+ * @param      gzip Whether it is for the gzip variant, which gets its own (input)
+ * @return     the length of the ETag
+ */
+size_t format_etag(char *buf, const struct stat *st, bool gzip);
+
+/**
+ * @brief      serialize_response_header() for a response with a file's
+ *             contents, adding its Last-Modified and ETag headers
+ *
+ * @param      buf            The buffer, RESPONSE_HEADER_MAX bytes (output)
+ * @param      status         The status (input)
+ * @param      content_type   The content type, may be NULL (input)
+ * @param      content_length The content length (input)
+ * @param      st             The file's stat() (input)
+ * @param      flags          RESPONSE_GZIP and RESPONSE_VARY (input)
+ * @return     the length of the headers, 0 if they don't fit
+ */
+size_t serialize_file_header(char *buf, Http_status status, const char *content_type,
+                             size_t content_length, const struct stat *st, int flags);
+
+/**
+ * @brief      Serialize the size line that starts a chunk of a chunked body.
+ *             The chunk data and a CRLF follow it, LAST_CHUNK ends the body.
+ *
+ * @param      buf  The buffer, CHUNK_HEADER_MAX bytes (output)
+ * @param      len  The length of the chunk data, not 0 (input)
+ * @return     the length of the line
+ */
+size_t serialize_chunk_header(char *buf, size_t len);
+
+/**
+ * @brief      Add a header line to headers serialize_response_header() made
+ *
+ * @param      buf  The headers, RESPONSE_HEADER_MAX bytes (input/output)
+ * @param      len  Their length, 0 if they didn't fit (input)
+ * @param      fmt  printf() format of the line, without the CRLF (input)
+ * @return     the new length, 0 if the line doesn't fit or len is 0
+ */
+size_t response_add_header(char *buf, size_t len, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+/**
+ * @brief      A complete body-less response for an error status
+ *
+ * Rendered once per thread and only refreshed when the Date changes, the
+ * returned buffer is thread-local and must not be freed.
+ *
+ * @param      status The status (input)
+ * @param      len    The length of the response (output)
+ * @return     the response
+ */
+const char *error_response(Http_status status, size_t *len);
+
+/**
+ * @brief      Format a time the way the Date header wants it
+ *
+ * @param      buf  The buffer (output)
+ * @param      size The size of the buffer (input)
+ * @param      now  The time to format (input)
+ * @return     the length of the formatted date
+ */
+size_t format_http_date(char *buf, size_t size, time_t now);
+
+/**
+ * @brief      Build the response to a request for a static file
+ *
+ * Large files are not read: response->body_fd is left open for the caller
+ * to send from and close, only the headers are serialized. For 200
+ * responses response->path names the file. The path and in-memory
+ * responses are allocated from arena and live until it is reset.
+ *
+ * @param      request     The request (input)
+ * @param      response    The response (output)
+ * @param      base_folder The folder files are served from (input)
+ * @param      arena       The arena of the request's connection (input)
+ * @return     the error code
+ */
+test_error_code_t process_http_request(Request *request, Response *response, char *base_folder,
+                                       struct arena *arena);
 
 
-char *serialize_http_response_wrapper(size_t *len, const char *response_type);
 #endif
@@ -0,0 +1,156 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the HTTP course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the HTTP project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "parse_http.h"
+#include "histogram.h"
+
+// Internal endpoint serving the counters of all workers as JSON
+#define STATS_URI "/__stats"
+// Default seconds between two dumps of --stats-file
+#define STATS_DUMP_SECS 10
+// Room for the JSON of stats_format()
+#define STATS_JSON_MAX 8192
+
+//Request methods counted apart
+typedef enum {
+    STATS_GET,
+    STATS_HEAD,
+    STATS_POST,
+    STATS_OTHER,
+    STATS_METHOD_COUNT
+} Stats_method;
+
+//Parts of handling a request that are timed
+typedef enum {
+    STATS_PHASE_PARSE,          //!< parse_http_request() of a complete request
+    STATS_PHASE_HANDLE,         //!< Building the response, file reads included when synchronous
+    STATS_PHASE_FILE_IO,        //!< A file read through io_uring, from start to completion
+    STATS_PHASE_SEND,           //!< One sendmsg() or sendfile() of responses
+    STATS_PHASE_COUNT
+} Stats_phase;
+
+//Counters of one worker. Only the worker writes them, with plain relaxed
+//stores since there is one writer, and readers on other threads load them
+//when they aggregate, so counting takes no locks and no atomic
+//read-modify-writes.
+struct worker_stats {
+    uint64_t responses[STATS_METHOD_COUNT][HTTP_STATUS_COUNT]; //!< By request method and status
+    uint64_t bytes_sent;        //!< Response bytes the socket took
+    uint64_t accepted;          //!< Connections accepted
+    uint64_t active;            //!< Connections open
+    uint64_t rejected;          //!< Connections turned away with a 503
+    uint64_t shed_per_ip;       //!< Of those, because their address had too many open
+    uint64_t shed_rate;         //!< Of those, because their address opened them too fast
+    uint64_t timed_out;         //!< Connections closed when a deadline passed
+    uint64_t parse_failed;      //!< Malformed requests
+    uint64_t parse_partial;     //!< parse_http_request() calls that needed more bytes
+    const struct file_cache *cache; //!< The worker's cache, for its hits and misses, may be NULL
+    struct histogram phases[STATS_PHASE_COUNT]; //!< Durations in ns
+};
+
+//Room stats_format() works in, set up once by each thread that calls it
+//rather than for every call: the merged histograms are over a megabyte
+struct stats_scratch {
+    struct histogram phases[STATS_PHASE_COUNT]; //!< The workers' histograms merged
+    char json[STATS_JSON_MAX];  //!< The document
+};
+
+/**
+ * @brief      Add to a counter. Only the owning worker may call this.
+ *
+ * @param      counter The counter (input/output)
+ * @param      n       The amount (input)
+ */
+static inline void stats_add(uint64_t *counter, uint64_t n)
+{
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief      Set up zeroed counters
+ *
+ * @param      stats The counters (output)
+ * @return     false when out of memory
+ */
+bool stats_init(struct worker_stats *stats);
+
+/**
+ * @brief      Free the histograms
+ *
+ * @param      stats The counters (input)
+ */
+void stats_destroy(struct worker_stats *stats);
+
+/**
+ * @brief      The counter slot of a request method
+ *
+ * @param      method The method, e.g. "GET" (input)
+ * @return     the slot
+ */
+Stats_method stats_method(const char *method);
+
+/**
+ * @brief      Count a response
+ *
+ * @param      stats  The worker's counters (input/output)
+ * @param      method The request's method (input)
+ * @param      status The response's status (input)
+ */
+void stats_count_response(struct worker_stats *stats, Stats_method method, Http_status status);
+
+/**
+ * @brief      Time a phase. Only the owning worker may call this.
+ *
+ * @param      stats The worker's counters (input/output)
+ * @param      phase The phase (input)
+ * @param      start When it started, from stats_now() (input)
+ */
+void stats_record(struct worker_stats *stats, Stats_phase phase, uint64_t start);
+
+/**
+ * @brief      A monotonic timestamp in ns
+ */
+uint64_t stats_now();
+
+/**
+ * @brief      Allocate the room for stats_format()
+ *
+ * @param      scratch The room (output)
+ * @return     false when out of memory
+ */
+bool stats_scratch_init(struct stats_scratch *scratch);
+
+/**
+ * @brief      Free the room for stats_format()
+ *
+ * @param      scratch The room (input)
+ */
+void stats_scratch_destroy(struct stats_scratch *scratch);
+
+/**
+ * @brief      Aggregate the counters of all workers into a JSON document.
+ *             Any thread may call this while the workers run, with a
+ *             scratch of its own.
+ *
+ * @param      stats     The counters of each worker (input)
+ * @param      n_workers The number of workers (input)
+ * @param      scratch   The room to work in, the JSON ends up in its json (input/output)
+ * @return     the length of the JSON, 0 if it doesn't fit
+ */
+size_t stats_format(struct worker_stats *stats, int n_workers, struct stats_scratch *scratch);
+
+#endif
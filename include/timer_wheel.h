@@ -0,0 +1,98 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the HTTP course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the HTTP project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Resolution of the wheel
+#define TIMER_TICK_MS 100
+// Slots of every level, a power of two
+#define TIMER_SLOT_BITS 6
+#define TIMER_SLOTS (1 << TIMER_SLOT_BITS)
+// Levels, every one covers TIMER_SLOTS times the span of the one below.
+// Four reach 64^4 ticks, about 19 days; later deadlines are cut to that
+#define TIMER_LEVELS 4
+
+//A deadline, embedded in whatever it times out. Unlinked when not armed.
+struct timer {
+    struct timer *next;         //!< Neighbours in the slot's list
+    struct timer *prev;
+    uint64_t expires;           //!< Tick the timer fires at
+};
+
+//Timers of one thread, not thread-safe
+struct timer_wheel {
+    uint64_t now;               //!< Last tick advanced to
+    size_t count;               //!< Armed timers
+    struct timer slots[TIMER_LEVELS][TIMER_SLOTS]; //!< List heads
+};
+
+/**
+ * @brief      Set up an empty wheel
+ *
+ * @param      wheel The wheel (output)
+ * @param      now   Current time in ms, see timer_now_ms() (input)
+ */
+void timer_wheel_init(struct timer_wheel *wheel, uint64_t now);
+
+/**
+ * @brief      Set up a timer that is not armed
+ *
+ * @param      timer The timer (output)
+ */
+void timer_init(struct timer *timer);
+
+/**
+ * @brief      Fire a timer after timeout_ms, re-arming it if it is armed
+ *             already. O(1).
+ *
+ * @param      wheel      The wheel (input)
+ * @param      timer      The timer (input)
+ * @param      timeout_ms Delay, rounded up to whole ticks (input)
+ */
+void timer_arm(struct timer_wheel *wheel, struct timer *timer, uint64_t timeout_ms);
+
+/**
+ * @brief      Disarm a timer, nothing happens if it isn't armed. O(1).
+ *
+ * @param      wheel The wheel (input)
+ * @param      timer The timer (input)
+ */
+void timer_cancel(struct timer_wheel *wheel, struct timer *timer);
+
+/**
+ * @brief      Whether the timer is armed
+ */
+bool timer_armed(const struct timer *timer);
+
+/**
+ * @brief      Move the wheel up to now and fire every timer that expired.
+ *             Timers are disarmed before expire is called, which may arm or
+ *             cancel any timer.
+ *
+ * @param      wheel  The wheel (input)
+ * @param      now    Current time in ms (input)
+ * @param      expire Called with every expired timer (input)
+ * @param      arg    Passed to expire (input)
+ * @return     number of timers fired
+ */
+size_t timer_wheel_advance(struct timer_wheel *wheel, uint64_t now,
+                           void (*expire)(struct timer *timer, void *arg), void *arg);
+
+/**
+ * @brief      CLOCK_MONOTONIC in ms
+ */
+uint64_t timer_now_ms();
+
+#endif
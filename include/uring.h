@@ -0,0 +1,101 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the HTTP course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the HTTP project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#ifndef URING_H
+#define URING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+// from <sys/stat.h> with _GNU_SOURCE
+struct statx;
+
+// Submission queue size of a worker's ring
+#define URING_ENTRIES 256
+
+//An io_uring instance driven through the raw system calls, one per worker
+struct uring {
+    int fd;                     //!< The ring
+    int eventfd;                //!< Signalled on every completion, for epoll
+    unsigned *sq_head;          //!< Submission queue, shared with the kernel
+    unsigned *sq_tail;
+    unsigned sq_mask;
+    unsigned *sq_array;
+    void *sqes;                 //!< struct io_uring_sqe[sq_entries]
+    unsigned sq_entries;
+    unsigned to_submit;         //!< Queued but not yet handed to the kernel
+    unsigned *cq_head;          //!< Completion queue, shared with the kernel
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    void *cqes;                 //!< struct io_uring_cqe[cq_entries]
+    unsigned cq_entries;
+    unsigned in_flight;         //!< Submitted operations not completed yet
+    void *sq_map;               //!< Mappings, for uring_destroy()
+    size_t sq_map_len;
+    size_t sqes_len;
+};
+
+/**
+ * @brief      Set up a ring that can open, stat and read files
+ *
+ * @param      entries Submission queue size (input)
+ * @return     the ring, NULL if the kernel has no io_uring or lacks one
+ *             of the operations, callers then do the I/O synchronously
+ */
+struct uring *uring_create(unsigned entries);
+
+/**
+ * @brief      Queue an openat(AT_FDCWD, path, flags). path has to stay valid
+ *             until the operation completes.
+ *
+ * @return     false if the ring is full
+ */
+bool uring_openat(struct uring *ring, const char *path, int flags, void *user);
+
+/**
+ * @brief      Queue a statx() of an open file
+ *
+ * @return     false if the ring is full
+ */
+bool uring_statx(struct uring *ring, int fd, struct statx *stx, void *user);
+
+/**
+ * @brief      Queue a pread()
+ *
+ * @return     false if the ring is full
+ */
+bool uring_read(struct uring *ring, int fd, void *buf, size_t len, off_t offset, void *user);
+
+/**
+ * @brief      Hand everything queued to the kernel
+ *
+ * @param      ring The ring (input)
+ */
+void uring_submit(struct uring *ring);
+
+/**
+ * @brief      Take the next completion off the ring
+ *
+ * @param      ring The ring (input)
+ * @param      user The user pointer the operation was queued with (output)
+ * @param      res  The result, -errno on failure (output)
+ * @return     false if there are none
+ */
+bool uring_complete(struct uring *ring, void **user, int *res);
+
+/**
+ * @brief      Close the ring
+ *
+ * @param      ring The ring (input)
+ */
+void uring_destroy(struct uring *ring);
+
+#endif
@@ -0,0 +1,146 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the HTTP course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the HTTP project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include <stdlib.h>
+#include <arpa/inet.h>
+
+#include "admission.h"
+
+#define SLOT_MASK (ADMISSION_STRIPE_SLOTS - 1)
+// A token, the bucket counts thousandths
+#define TOKEN 1000
+
+struct admission *admission_create(uint32_t max_per_ip, uint32_t rate, uint32_t burst)
+{
+  // the stripes are cache line aligned, so a worker's lock doesn't share a
+  // line with another stripe's
+  struct admission *adm = aligned_alloc(64, sizeof(struct admission));
+  if (adm == NULL)
+    return NULL;
+  adm->max_per_ip = max_per_ip;
+  adm->rate = rate;
+  adm->burst = (uint64_t)(burst > 0 ? burst : 1) * TOKEN;
+  for (int i = 0; i < ADMISSION_STRIPES; i++)
+  {
+    pthread_mutex_init(&adm->stripes[i].lock, NULL);
+    for (int j = 0; j < ADMISSION_STRIPE_SLOTS; j++)
+      adm->stripes[i].clients[j].addr = 0;
+  }
+  return adm;
+}
+
+/* spreads addresses of the same subnet over the stripes and slots. the
+  stripe comes from the high bits of the hash and the slot from the low
+  ones, so every bit of the address has to reach both: murmur3's finalizer */
+static uint32_t hash_addr(uint32_t addr)
+{
+  uint32_t h = ntohl(addr);
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return h;
+}
+
+static struct admission_stripe *stripe_of(struct admission *adm, uint32_t hash)
+{
+  return &adm->stripes[hash >> (32 - __builtin_ctz(ADMISSION_STRIPES))];
+}
+
+/* tops the client's bucket up with what it earned since the last time. a
+  rate of r a second is r thousandths a ms */
+static void refill(struct admission *adm, struct admission_client *client, uint64_t now)
+{
+  // other threads may have read the clock a little later
+  if ((adm->rate == 0) || (now <= client->refilled))
+    return;
+  uint64_t earned = (now - client->refilled) * adm->rate;
+  client->tokens = earned >= adm->burst - client->tokens ? adm->burst : client->tokens + earned;
+  client->refilled = now;
+}
+
+/* the client in the stripe with addr, NULL if it isn't tracked */
+static struct admission_client *find(struct admission_stripe *stripe, uint32_t hash,
+                                     uint32_t addr)
+{
+  for (int i = 0; i < ADMISSION_PROBE; i++)
+  {
+    struct admission_client *client = &stripe->clients[(hash + i) & SLOT_MASK];
+    if (client->addr == addr)
+      return client;
+  }
+  return NULL;
+}
+
+/* a slot for a client that isn't tracked yet: a free one, or one of a
+  client that is indistinguishable from a new one. NULL if there is none */
+static struct admission_client *claim(struct admission *adm, struct admission_stripe *stripe,
+                                      uint32_t hash, uint32_t addr, uint64_t now)
+{
+  for (int i = 0; i < ADMISSION_PROBE; i++)
+  {
+    struct admission_client *client = &stripe->clients[(hash + i) & SLOT_MASK];
+    if (client->addr != 0)
+    {
+      refill(adm, client, now);
+      if ((client->conns > 0) || ((adm->rate > 0) && (client->tokens < adm->burst)))
+        continue;
+    }
+    client->addr = addr;
+    client->conns = 0;
+    client->tokens = adm->burst;
+    client->refilled = now;
+    return client;
+  }
+  return NULL;
+}
+
+Admission_verdict admission_enter(struct admission *adm, uint32_t addr, uint64_t now)
+{
+  uint32_t hash = hash_addr(addr);
+  struct admission_stripe *stripe = stripe_of(adm, hash);
+  Admission_verdict verdict = ADMIT;
+  pthread_mutex_lock(&stripe->lock);
+  struct admission_client *client = find(stripe, hash, addr);
+  if (client == NULL)
+    client = claim(adm, stripe, hash, addr, now);
+  if (client == NULL)
+  {
+    verdict = ADMIT_UNTRACKED;
+  }
+  else
+  {
+    refill(adm, client, now);
+    if ((adm->max_per_ip > 0) && (client->conns >= adm->max_per_ip))
+      verdict = SHED_PER_IP;
+    else if ((adm->rate > 0) && (client->tokens < TOKEN))
+      verdict = SHED_RATE;
+    else
+    {
+      if (adm->rate > 0)
+        client->tokens -= TOKEN;
+      client->conns++;
+    }
+  }
+  pthread_mutex_unlock(&stripe->lock);
+  return verdict;
+}
+
+void admission_leave(struct admission *adm, uint32_t addr)
+{
+  uint32_t hash = hash_addr(addr);
+  struct admission_stripe *stripe = stripe_of(adm, hash);
+  pthread_mutex_lock(&stripe->lock);
+  struct admission_client *client = find(stripe, hash, addr);
+  if ((client != NULL) && (client->conns > 0))
+    client->conns--;
+  pthread_mutex_unlock(&stripe->lock);
+}
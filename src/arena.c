@@ -0,0 +1,125 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the HTTP course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the HTTP project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stdalign.h>
+
+#include "arena.h"
+
+#define ALIGN_UP(__n) (((__n) + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1))
+
+void arena_init(struct arena *arena, size_t block_size)
+{
+  arena->first = NULL;
+  arena->current = NULL;
+  arena->block_size = block_size;
+  arena->total = 0;
+}
+
+static struct arena_block *new_block(struct arena *arena, size_t size)
+{
+  struct arena_block *block = malloc(sizeof(struct arena_block) + size);
+  if (block == NULL)
+    return NULL;
+  block->next = NULL;
+  block->size = size;
+  block->used = 0;
+  arena->total += size;
+  return block;
+}
+
+void *arena_alloc(struct arena *arena, size_t size)
+{
+  size = ALIGN_UP(size);
+  struct arena_block *block = arena->current;
+  if ((block != NULL) && (block->size - block->used >= size))
+  {
+    void *p = block->data + block->used;
+    block->used += size;
+    return p;
+  }
+
+  // blocks after the current one are left over from before the last reset
+  if ((block != NULL) && (block->next != NULL) && (block->next->size >= size))
+  {
+    block = block->next;
+    block->used = 0;
+  }
+  else
+  {
+    struct arena_block *fresh = new_block(arena, size > arena->block_size ? size : arena->block_size);
+    if (fresh == NULL)
+      return NULL;
+    if (block == NULL)
+    {
+      arena->first = fresh;
+    }
+    else
+    {
+      fresh->next = block->next;
+      block->next = fresh;
+    }
+    block = fresh;
+  }
+  arena->current = block;
+  block->used = size;
+  return block->data;
+}
+
+char *arena_strdup(struct arena *arena, const char *str)
+{
+  size_t len = strlen(str) + 1;
+  char *copy = arena_alloc(arena, len);
+  if (copy != NULL)
+    memcpy(copy, str, len);
+  return copy;
+}
+
+void arena_reset(struct arena *arena)
+{
+  if (arena->first == NULL)
+    return;
+  // a burst of big responses should not pin that memory to an idle
+  // connection
+  if (arena->total > ARENA_KEEP_BYTES)
+  {
+    struct arena_block *block = arena->first->next;
+    while (block != NULL)
+    {
+      struct arena_block *next = block->next;
+      arena->total -= block->size;
+      free(block);
+      block = next;
+    }
+    arena->first->next = NULL;
+    // nor a single big one, which would be the first block of a connection
+    // whose first request was big
+    if (arena->first->size > ARENA_KEEP_BYTES)
+    {
+      arena_destroy(arena);
+      return;
+    }
+  }
+  arena->current = arena->first;
+  arena->first->used = 0;
+}
+
+void arena_destroy(struct arena *arena)
+{
+  struct arena_block *block = arena->first;
+  while (block != NULL)
+  {
+    struct arena_block *next = block->next;
+    free(block);
+    block = next;
+  }
+  arena_init(arena, arena->block_size);
+}
@@ -9,100 +9,517 @@
  * without the express permission of the 15-441/641 course staff.
  */
 #include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
 #include <unistd.h>
 #include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <getopt.h>
 #include <arpa/inet.h>
 
 #include <parse_http.h>
+#include <load.h>
 #include <test_error.h>
 #include <ports.h>
 
 #include <errno.h>
 
-int main(int argc, char *argv[]) {
-    /* Validate and parse args */
-    if (argc != 2) {
-        fprintf(stderr, "usage: %s <server-ip>\n", argv[0]);
-        return EXIT_FAILURE;
+// Connections opened to the server by default
+#define DEFAULT_CONNECTIONS 4
+// Requests in flight on one connection by default
+#define DEFAULT_PIPELINE 4
+#define MAX_CONNECTIONS 64
+#define MAX_PIPELINE 32
+// Times a request is resent after its connection went away
+#define MAX_RETRIES 3
+
+// Receive buffer of a connection. Bodies are consumed as they arrive, so it
+// only ever holds headers and the tail of a read
+#define RECV_BUF_SIZE (64 * 1024)
+
+/* one file of the page. its parent is the file that loads it */
+struct object {
+    char *name;
+    int parent;             // Index of the parent, -1 for the page itself
+    int *children;
+    int n_children;
+    int priority;           // Objects on the longest chain starting here
+    int retries;
+    int status;             // HTTP status, 0 until it is done
+    size_t bytes;           // Body bytes received
+    double t_ready;         // When its parent was done, ms since start
+    double t_sent;
+    double t_first;         // First byte of the response
+    double t_done;
+};
+
+/* a keep-alive connection with up to pipeline requests in flight */
+struct conn {
+    int fd;                     // -1 while not connected
+    int inflight[MAX_PIPELINE]; // Objects requested, oldest first
+    int head;
+    int count;
+    Http_response_parser parser; // Response to inflight[head]
+    char buf[RECV_BUF_SIZE];    // Received bytes not consumed yet
+    size_t len;
+};
+
+static struct object *objects;
+static int n_objects;
+static int remaining;       // Objects not done or given up on yet
+static int *ready;          // Max-heap of objects whose parent is done, by priority
+static int n_ready;
+static struct timespec start;
+
+static double now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec - start.tv_sec) * 1e3 + (ts.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+static void ready_push(int obj) {
+    int i = n_ready++;
+    while (i > 0 && objects[ready[(i - 1) / 2]].priority < objects[obj].priority) {
+        ready[i] = ready[(i - 1) / 2];
+        i = (i - 1) / 2;
     }
-    
-    /* Set up a connection to the HTTP server */
-    int sockfd;
-    struct sockaddr_in sin;
-    if ((sockfd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
-        return TEST_ERROR_HTTP_CONNECT_FAILED;
+    ready[i] = obj;
+}
+
+static int ready_pop() {
+    int top = ready[0];
+    int last = ready[--n_ready];
+    int i = 0;
+    while (1) {
+        int child = 2 * i + 1;
+        if (child >= n_ready)
+            break;
+        if (child + 1 < n_ready && objects[ready[child + 1]].priority > objects[ready[child]].priority)
+            child++;
+        if (objects[ready[child]].priority <= objects[last].priority)
+            break;
+        ready[i] = ready[child];
+        i = child;
     }
+    ready[i] = last;
+    return top;
+}
+
+static int find_object(const char *name) {
+    for (int i = 0; i < n_objects; i++)
+        if (strcmp(objects[i].name, name) == 0)
+            return i;
+    return -1;
+}
+
+/* trims spaces and a trailing CR in place */
+static char *trim(char *s) {
+    while (*s == ' ' || *s == '\t')
+        s++;
+    size_t len = strlen(s);
+    while (len > 0 && (s[len - 1] == ' ' || s[len - 1] == '\t' || s[len - 1] == '\r'))
+        s[--len] = '\0';
+    return s;
+}
 
+/* builds the dependency DAG from "file,parent" lines, parent empty for the
+  page itself */
+static int load_dependencies(char *csv) {
+    int cap = 0;
+    char **parents = NULL;
+    char *save;
+    for (char *line = strtok_r(csv, "\n", &save); line != NULL; line = strtok_r(NULL, "\n", &save)) {
+        char *comma = strchr(line, ',');
+        char *parent = "";
+        if (comma != NULL) {
+            *comma = '\0';
+            parent = comma + 1;
+        }
+        char *name = trim(line);
+        if (*name == '\0' || find_object(name) >= 0)
+            continue;
+        if (n_objects == cap) {
+            cap = cap == 0 ? 64 : 2 * cap;
+            objects = realloc(objects, cap * sizeof(struct object));
+            parents = realloc(parents, cap * sizeof(char *));
+            if (objects == NULL || parents == NULL)
+                return -1;
+        }
+        memset(&objects[n_objects], 0, sizeof(struct object));
+        objects[n_objects].name = strdup(name);
+        parents[n_objects] = trim(parent);
+        n_objects++;
+    }
+
+    for (int i = 0; i < n_objects; i++) {
+        objects[i].parent = *parents[i] == '\0' ? -1 : find_object(parents[i]);
+        if (*parents[i] != '\0' && objects[i].parent < 0)
+            fprintf(stderr, "%s depends on unknown %s, fetching it right away\n",
+                    objects[i].name, parents[i]);
+    }
+    free(parents);
+    for (int i = 0; i < n_objects; i++) {
+        int p = objects[i].parent;
+        if (p < 0)
+            continue;
+        objects[p].children = realloc(objects[p].children, (objects[p].n_children + 1) * sizeof(int));
+        if (objects[p].children == NULL)
+            return -1;
+        objects[p].children[objects[p].n_children++] = i;
+    }
+
+    // critical path first: an object's priority is the length of the
+    // longest chain of objects it holds up. every object has one parent,
+    // so walking up from each one visits every chain
+    for (int i = 0; i < n_objects; i++) {
+        int depth = 1;
+        for (int p = i, steps = 0; p >= 0 && steps <= n_objects; p = objects[p].parent, steps++) {
+            if (objects[p].priority < depth)
+                objects[p].priority = depth;
+            depth++;
+        }
+    }
+    ready = malloc(n_objects * sizeof(int));
+    return ready == NULL ? -1 : 0;
+}
+
+static int connect_server(struct sockaddr_in *sin) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
     int optval = 1;
-    setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(int));
-    setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(int));
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &optval, sizeof(optval));
+    if (connect(fd, (struct sockaddr *)sin, sizeof(*sin)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int send_request(struct conn *c, const char *host, const char *path) {
+    char buf[8192];
+    int size = snprintf(buf, sizeof(buf), "%s /%s %s%s%s%s%s%s%s%s%s", GET, path, HTTP_VER, CRLF,
+                        HOST, host, CRLF, CONNECTION, CONNECTION_VAL, CRLF, CRLF);
+    if (size < 0 || (size_t)size >= sizeof(buf))
+        return -1;
+    // requests are small and the server reads them right away, so a
+    // blocking send never waits long
+    for (int done = 0; done < size;) {
+        ssize_t n = send(c->fd, buf + done, size - done, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        done += n;
+    }
+    return 0;
+}
+
+/* the connection went away: requests in flight go back to the ready queue,
+  counting as a failed attempt unless the server announced the close */
+static void drop_connection(struct conn *c, bool failed) {
+    if (c->fd >= 0)
+        close(c->fd);
+    c->fd = -1;
+    for (int i = 0; i < c->count; i++) {
+        int obj = c->inflight[(c->head + i) % MAX_PIPELINE];
+        if (failed && ++objects[obj].retries > MAX_RETRIES) {
+            fprintf(stderr, "giving up on %s\n", objects[obj].name);
+            objects[obj].status = -1;
+            objects[obj].t_done = now_ms();
+            remaining--;
+            continue;
+        }
+        ready_push(obj);
+    }
+    c->count = 0;
+    c->head = 0;
+    c->len = 0;
+    response_parser_reset(&c->parser);
+}
 
+/* the response to the oldest request on the connection is complete */
+static void complete_response(struct conn *c, double t) {
+    int obj = c->inflight[c->head];
+    objects[obj].status = c->parser.status;
+    objects[obj].bytes = c->parser.body_len;
+    objects[obj].t_done = t;
+    c->head = (c->head + 1) % MAX_PIPELINE;
+    c->count--;
+    remaining--;
+    response_parser_reset(&c->parser);
+    for (int k = 0; k < objects[obj].n_children; k++) {
+        int child = objects[obj].children[k];
+        objects[child].t_ready = t;
+        ready_push(child);
+    }
+}
+
+static void usage(char *prog) {
+    fprintf(stderr, "usage: %s [--connections N] [--pipeline N] <server-ip> [dependency-csv-path]\n", prog);
+    fprintf(stderr, "       %s load --help\n", prog);
+}
+
+struct growing_buf {
+    char *data;
+    size_t len;
+    size_t cap;
+};
+
+static bool append_body(void *user, const char *data, size_t len) {
+    struct growing_buf *b = user;
+    if (b->cap - b->len <= len) {
+        size_t cap = 2 * (b->len + len) + 1;
+        char *grown = realloc(b->data, cap);
+        if (grown == NULL)
+            return false;
+        b->data = grown;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+    b->data[b->len] = '\0';
+    return true;
+}
+
+/* fetches one path synchronously, used for the dependency list itself */
+static char *fetch_whole(struct sockaddr_in *sin, const char *host, const char *path) {
+    static struct conn c;
+    c.fd = connect_server(sin);
+    if (c.fd < 0)
+        return NULL;
+    struct growing_buf body = {NULL, 0, 0};
+    c.parser.body_fd = -1;
+    c.parser.on_body = append_body;
+    c.parser.user = &body;
+    response_parser_reset(&c.parser);
+    test_error_code_t err = TEST_ERROR_PARSE_PARTIAL;
+    if (send_request(&c, host, path) == 0) {
+        while (err == TEST_ERROR_PARSE_PARTIAL) {
+            // the parser took all it could, a full buffer holds a response it
+            // never will. recv() into no room would read as the server closing
+            if (c.len == sizeof(c.buf)) {
+                err = TEST_ERROR_PARSE_FAILED;
+                break;
+            }
+            ssize_t n = recv(c.fd, c.buf + c.len, sizeof(c.buf) - c.len, 0);
+            if (n <= 0) {
+                err = n == 0 ? parse_http_response_eof(&c.parser) : TEST_ERROR_PARSE_FAILED;
+                break;
+            }
+            c.len += n;
+            size_t consumed;
+            err = parse_http_response(&c.parser, c.buf, c.len, &consumed);
+            memmove(c.buf, c.buf + consumed, c.len - consumed);
+            c.len -= consumed;
+        }
+    }
+    close(c.fd);
+    if (err != TEST_ERROR_NONE || c.parser.status != 200) {
+        free(body.data);
+        return NULL;
+    }
+    return body.data != NULL ? body.data : strdup("");
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "load") == 0)
+        return load_main(argc - 1, argv + 1);
+
+    int n_conns = DEFAULT_CONNECTIONS;
+    int pipeline = DEFAULT_PIPELINE;
+    static struct option long_options[] = {
+        {"connections", required_argument, NULL, 'c'},
+        {"pipeline", required_argument, NULL, 'p'},
+        {NULL, 0, NULL, 0}};
+    int opt;
+    while ((opt = getopt_long(argc, argv, "c:p:", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'c':
+            n_conns = atoi(optarg);
+            if (n_conns < 1 || n_conns > MAX_CONNECTIONS) {
+                fprintf(stderr, "--connections must be between 1 and %d\n", MAX_CONNECTIONS);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'p':
+            pipeline = atoi(optarg);
+            if (pipeline < 1 || pipeline > MAX_PIPELINE) {
+                fprintf(stderr, "--pipeline must be between 1 and %d\n", MAX_PIPELINE);
+                return EXIT_FAILURE;
+            }
+            break;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (optind != argc - 1 && optind != argc - 2) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    const char *host = argv[optind];
+    const char *csv_path = optind == argc - 2 ? argv[optind + 1] : "dependency.csv";
+    if (*csv_path == '/')
+        csv_path++;
+
+    struct sockaddr_in sin;
+    memset(&sin, 0, sizeof(sin));
     sin.sin_family = AF_INET;
     sin.sin_port = htons(HTTP_PORT);
-    inet_pton(AF_INET, argv[1], &(sin.sin_addr));
-    
-    fprintf(stderr, "Parsed IP address of the server: %X\n", htonl(sin.sin_addr.s_addr));
+    if (inet_pton(AF_INET, host, &sin.sin_addr) != 1) {
+        fprintf(stderr, "not an IPv4 address: %s\n", host);
+        return EXIT_FAILURE;
+    }
 
-    if(connect(sockfd, (struct sockaddr *)&sin, sizeof(sin)) < 0){
-        printf("error on connect\n");
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    char *csv = fetch_whole(&sin, host, csv_path);
+    if (csv == NULL) {
+        fprintf(stderr, "couldn't fetch /%s\n", csv_path);
         return TEST_ERROR_HTTP_CONNECT_FAILED;
     }
+    if (load_dependencies(csv) < 0) {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_FAILURE;
+    }
+    free(csv);
+    if (n_conns > n_objects)
+        n_conns = n_objects > 0 ? n_objects : 1;
 
-    /* CP1: Send out a HTTP request, waiting for the response */
-    // const int header_count = 1;
-    // Request_header headers[header_count];
-    // Request_header header_0;
-    // memcpy(header_0.header_name, "connection", 5);
-    // memcpy(header_0.header_name, "close", 8);
-    // headers[0] = header_0;
-    Request request = {
-      "1.1",
-      "GET",
-      "/index.html",
-      "127.0.0.1",
-      // headers,
-      // header_count,
-      // header_count,
-      NULL,
-      0,
-      0,
-      0,
-      NULL,
-      0
-    };
-    char buf[8192];
-    size_t size;
-    int err = serialize_http_request(buf, &size, &request);
-    if(err != TEST_ERROR_NONE) {
-      printf("error serializing request\n");
-    }
-    buf[size] = '\0';
-    for(int i = 0; i < 10; i++) {
-      printf("sending request %d:\n%s\n", i + 1, buf);
-      err = send(sockfd, buf, size, 0);
-      if(err < 0) {
-        printf("error sending msg\n");
-      }
-    }
-    printf("sent msgs!\n");
-    int len;
-    while((len = recv(sockfd, buf, 8192, MSG_DONTWAIT)) > 0) {
-    }
-    printf("recved msgs!\n");
-    sleep(5);
-    for(int i = 0; i < 10; i++) {
-      printf("sending request %d:\n%s\n", i + 1, buf);
-      err = send(sockfd, buf, size, 0);
-      if(err < 0) {
-        printf("error sending msg\n");
-      }
-    }
-    while((len = recv(sockfd, buf, 8192, MSG_DONTWAIT)) > 0) {
-    }
-    sleep(3);
-    printf("ok I, the client, am going now, bye!\n");
-
-    // parse_http_response should be implemeted in CP2
+    double t_start = now_ms();
+    for (int i = 0; i < n_objects; i++) {
+        if (objects[i].parent < 0) {
+            objects[i].t_ready = t_start;
+            ready_push(i);
+        }
+    }
+
+    static struct conn conns[MAX_CONNECTIONS];
+    struct pollfd pfds[MAX_CONNECTIONS];
+    for (int i = 0; i < n_conns; i++) {
+        conns[i].fd = -1;
+        // bodies are only counted, parser.body_len has their size
+        conns[i].parser.body_fd = -1;
+        conns[i].parser.on_body = NULL;
+        response_parser_reset(&conns[i].parser);
+    }
+
+    remaining = n_objects;
+    while (remaining > 0) {
+        // hand out ready objects, most critical first, to the connection
+        // with the fewest requests in flight
+        while (n_ready > 0) {
+            struct conn *best = NULL;
+            for (int i = 0; i < n_conns; i++)
+                if (conns[i].count < pipeline && (best == NULL || conns[i].count < best->count))
+                    best = &conns[i];
+            if (best == NULL)
+                break;
+            if (best->fd < 0 && (best->fd = connect_server(&sin)) < 0) {
+                fprintf(stderr, "couldn't connect to %s: %s\n", host, strerror(errno));
+                return TEST_ERROR_HTTP_CONNECT_FAILED;
+            }
+            int obj = ready_pop();
+            best->inflight[(best->head + best->count) % MAX_PIPELINE] = obj;
+            best->count++;
+            objects[obj].t_sent = now_ms();
+            if (send_request(best, host, objects[obj].name) < 0)
+                drop_connection(best, true);
+        }
+
+        int n_pfds = 0;
+        for (int i = 0; i < n_conns; i++) {
+            pfds[i].fd = conns[i].count > 0 ? conns[i].fd : -1;
+            pfds[i].events = POLLIN;
+            pfds[i].revents = 0;
+            n_pfds += conns[i].count > 0;
+        }
+        if (n_pfds == 0) {
+            // nothing in flight and nothing ready: the rest were given up on
+            for (int i = 0; i < n_objects; i++)
+                if (objects[i].status == 0)
+                    objects[i].status = -1;
+            break;
+        }
+        if (poll(pfds, n_conns, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("poll");
+            return EXIT_FAILURE;
+        }
+
+        for (int i = 0; i < n_conns; i++) {
+            struct conn *c = &conns[i];
+            if (pfds[i].revents == 0)
+                continue;
+            ssize_t n = recv(c->fd, c->buf + c->len, sizeof(c->buf) - c->len, MSG_DONTWAIT);
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+                continue;
+            double t = now_ms();
+            if (n <= 0) {
+                // a body without a length ends with the connection
+                if (n == 0 && c->len == 0 && parse_http_response_eof(&c->parser) == TEST_ERROR_NONE)
+                    complete_response(c, t);
+                drop_connection(c, true);
+                continue;
+            }
+            c->len += n;
+            if (objects[c->inflight[c->head]].t_first == 0)
+                objects[c->inflight[c->head]].t_first = t;
+
+            // pipelined responses come back in order, one per request
+            size_t off = 0;
+            while (c->count > 0) {
+                size_t consumed;
+                test_error_code_t err = parse_http_response(&c->parser, c->buf + off, c->len - off, &consumed);
+                off += consumed;
+                if (err == TEST_ERROR_PARSE_FAILED) {
+                    fprintf(stderr, "garbled response on connection %d\n", i);
+                    drop_connection(c, true);
+                    break;
+                }
+                if (err == TEST_ERROR_PARSE_PARTIAL)
+                    break;
+                bool keep_alive = c->parser.keep_alive;
+                complete_response(c, t);
+                if (!keep_alive) {
+                    drop_connection(c, false);
+                    break;
+                }
+                if (c->count > 0 && off < c->len)
+                    objects[c->inflight[c->head]].t_first = t;
+            }
+            if (c->fd >= 0) {
+                memmove(c->buf, c->buf + off, c->len - off);
+                c->len -= off;
+                // the parser took all it could, a full buffer holds a response
+                // it never will. recv() into no room would read as the server
+                // closing
+                if (c->len == sizeof(c->buf)) {
+                    fprintf(stderr, "garbled response on connection %d\n", i);
+                    drop_connection(c, true);
+                }
+            }
+        }
+    }
+    double t_end = now_ms();
+
+    size_t total = 0;
+    printf("%-32s %6s %10s %10s %10s %10s\n", "object", "status", "bytes", "sent(ms)", "ttfb(ms)",
+           "done(ms)");
+    for (int i = 0; i < n_objects; i++) {
+        struct object *o = &objects[i];
+        total += o->bytes;
+        printf("%-32s %6d %10zu %10.3f %10.3f %10.3f\n", o->name, o->status, o->bytes,
+               o->t_sent - t_start, o->t_first > 0 ? o->t_first - o->t_sent : 0,
+               o->t_done - t_start);
+    }
+    printf("page load time: %.3f ms, %d objects, %zu bytes, %d connections, pipeline %d\n",
+           t_end - t_start, n_objects, total, n_conns, pipeline);
+    return EXIT_SUCCESS;
 }
@@ -0,0 +1,182 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the HTTP course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the HTTP project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <dirent.h>
+#include <limits.h>
+
+#include "dir_listing.h"
+
+// Longest part of the URI shown in the title
+#define TITLE_URI_MAX 512
+// Worst case of one entry: the name percent-encoded in the link and
+// HTML-escaped as its text
+#define ROW_MAX (3 * NAME_MAX + 6 * NAME_MAX + 64)
+
+enum listing_phase
+{
+  PHASE_HEAD,
+  PHASE_ENTRIES,
+  PHASE_FOOT,
+  PHASE_DONE,
+};
+
+struct dir_listing
+{
+  DIR *dir;
+  char *title; // The URI, HTML-escaped
+  enum listing_phase phase;
+};
+
+/* writes str with the characters HTML gives a meaning to escaped, returns
+  the length written. out needs room for 6 bytes per byte of str */
+static size_t html_escape(char *out, const char *str, size_t len)
+{
+  char *p = out;
+  for (size_t i = 0; i < len; i++)
+  {
+    const char *entity = NULL;
+    switch (str[i])
+    {
+    case '&':
+      entity = "&amp;";
+      break;
+    case '<':
+      entity = "&lt;";
+      break;
+    case '>':
+      entity = "&gt;";
+      break;
+    case '"':
+      entity = "&quot;";
+      break;
+    case '\'':
+      entity = "&#39;";
+      break;
+    }
+    if (entity == NULL)
+    {
+      *p++ = str[i];
+    }
+    else
+    {
+      size_t n = strlen(entity);
+      memcpy(p, entity, n);
+      p += n;
+    }
+  }
+  return p - out;
+}
+
+/* writes a path segment with everything but unreserved characters
+  percent-encoded. out needs room for 3 bytes per byte of str */
+static size_t url_escape(char *out, const char *str)
+{
+  static const char hex[] = "0123456789ABCDEF";
+  char *p = out;
+  for (; *str; str++)
+  {
+    unsigned char c = *str;
+    if (((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) || ((c >= '0') && (c <= '9')) ||
+        (c == '-') || (c == '.') || (c == '_') || (c == '~'))
+    {
+      *p++ = c;
+    }
+    else
+    {
+      *p++ = '%';
+      *p++ = hex[c >> 4];
+      *p++ = hex[c & 0xf];
+    }
+  }
+  return p - out;
+}
+
+struct dir_listing *dir_listing_open(const char *path, const char *uri)
+{
+  struct dir_listing *listing = calloc(1, sizeof(struct dir_listing));
+  if (listing == NULL)
+    return NULL;
+  size_t uri_len = strlen(uri);
+  if (uri_len > TITLE_URI_MAX)
+    uri_len = TITLE_URI_MAX;
+  listing->title = malloc(6 * uri_len + 1);
+  listing->dir = opendir(path);
+  if ((listing->title == NULL) || (listing->dir == NULL))
+  {
+    dir_listing_close(listing);
+    return NULL;
+  }
+  listing->title[html_escape(listing->title, uri, uri_len)] = '\0';
+  listing->phase = PHASE_HEAD;
+  return listing;
+}
+
+ssize_t dir_listing_read(void *arg, char *buf, size_t cap)
+{
+  struct dir_listing *listing = arg;
+  size_t used = 0;
+  while (listing->phase != PHASE_DONE)
+  {
+    if (listing->phase == PHASE_HEAD)
+    {
+      // the title is at most 6 * TITLE_URI_MAX bytes, twice that fits in
+      // DIR_LISTING_MIN_BUF
+      used += snprintf(buf + used, cap - used,
+                       "<!DOCTYPE html>\n<html><head><title>Index of %s</title></head>\n"
+                       "<body><h1>Index of %s</h1>\n<ul>\n",
+                       listing->title, listing->title);
+      listing->phase = PHASE_ENTRIES;
+    }
+    else if (listing->phase == PHASE_ENTRIES)
+    {
+      // the rest goes into the next piece
+      if (cap - used < ROW_MAX)
+        break;
+      struct dirent *entry = readdir(listing->dir);
+      if (entry == NULL)
+      {
+        listing->phase = PHASE_FOOT;
+        continue;
+      }
+      if (strcmp(entry->d_name, ".") == 0)
+        continue;
+      const char *slash = entry->d_type == DT_DIR ? "/" : "";
+      char *p = buf + used;
+      p += sprintf(p, "<li><a href=\"");
+      p += url_escape(p, entry->d_name);
+      p += sprintf(p, "%s\">", slash);
+      p += html_escape(p, entry->d_name, strlen(entry->d_name));
+      p += sprintf(p, "%s</a></li>\n", slash);
+      used = p - buf;
+    }
+    else
+    {
+      static const char foot[] = "</ul>\n</body></html>\n";
+      if (cap - used < sizeof(foot))
+        break;
+      memcpy(buf + used, foot, sizeof(foot) - 1);
+      used += sizeof(foot) - 1;
+      listing->phase = PHASE_DONE;
+    }
+  }
+  return used;
+}
+
+void dir_listing_close(void *arg)
+{
+  struct dir_listing *listing = arg;
+  if (listing->dir != NULL)
+    closedir(listing->dir);
+  free(listing->title);
+  free(listing);
+}
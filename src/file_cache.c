@@ -0,0 +1,235 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the HTTP course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the HTTP project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "file_cache.h"
+
+#define INITIAL_BUCKETS 64
+
+/* FNV-1a */
+static size_t hash_key(const char *key)
+{
+  size_t h = 14695981039346656037ULL;
+  for (; *key; key++)
+  {
+    h ^= (unsigned char)*key;
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+static int same_file(const struct cache_entry *entry, const struct stat *st)
+{
+  return (entry->size == st->st_size) && (entry->ino == st->st_ino) &&
+         (entry->mtime.tv_sec == st->st_mtim.tv_sec) &&
+         (entry->mtime.tv_nsec == st->st_mtim.tv_nsec);
+}
+
+struct file_cache *file_cache_create(size_t capacity)
+{
+  struct file_cache *cache = calloc(1, sizeof(struct file_cache));
+  if (cache == NULL)
+    return NULL;
+  cache->buckets = calloc(INITIAL_BUCKETS, sizeof(struct cache_entry *));
+  if (cache->buckets == NULL)
+  {
+    free(cache);
+    return NULL;
+  }
+  cache->n_buckets = INITIAL_BUCKETS;
+  cache->capacity = capacity;
+  // one huge file should not be able to flush everything else
+  cache->max_entry = capacity / 8;
+  return cache;
+}
+
+void cache_entry_release(struct cache_entry *entry)
+{
+  if (--entry->refs > 0)
+    return;
+  free(entry->key);
+  free(entry->path);
+  free(entry->blob);
+  free(entry);
+}
+
+static void lru_unlink(struct file_cache *cache, struct cache_entry *entry)
+{
+  if (entry->prev != NULL)
+    entry->prev->next = entry->next;
+  else
+    cache->head = entry->next;
+  if (entry->next != NULL)
+    entry->next->prev = entry->prev;
+  else
+    cache->tail = entry->prev;
+  entry->prev = entry->next = NULL;
+}
+
+static void lru_push_front(struct file_cache *cache, struct cache_entry *entry)
+{
+  entry->prev = NULL;
+  entry->next = cache->head;
+  if (cache->head != NULL)
+    cache->head->prev = entry;
+  cache->head = entry;
+  if (cache->tail == NULL)
+    cache->tail = entry;
+}
+
+/* takes the entry out of the cache. senders still holding a reference keep
+  it alive until they release it */
+static void cache_remove(struct file_cache *cache, struct cache_entry *entry)
+{
+  struct cache_entry **link = &cache->buckets[hash_key(entry->key) & (cache->n_buckets - 1)];
+  while (*link != entry)
+    link = &(*link)->hnext;
+  *link = entry->hnext;
+  lru_unlink(cache, entry);
+  cache->used -= entry->charge;
+  cache->n_entries--;
+  cache_entry_release(entry);
+}
+
+static void cache_grow(struct file_cache *cache)
+{
+  size_t n_buckets = 2 * cache->n_buckets;
+  struct cache_entry **buckets = calloc(n_buckets, sizeof(struct cache_entry *));
+  if (buckets == NULL)
+    return; // longer chains, still correct
+  for (size_t i = 0; i < cache->n_buckets; i++)
+  {
+    struct cache_entry *entry = cache->buckets[i];
+    while (entry != NULL)
+    {
+      struct cache_entry *next = entry->hnext;
+      size_t b = hash_key(entry->key) & (n_buckets - 1);
+      entry->hnext = buckets[b];
+      buckets[b] = entry;
+      entry = next;
+    }
+  }
+  free(cache->buckets);
+  cache->buckets = buckets;
+  cache->n_buckets = n_buckets;
+}
+
+struct cache_entry *file_cache_lookup(struct file_cache *cache, const char *key, time_t now)
+{
+  struct cache_entry *entry = cache->buckets[hash_key(key) & (cache->n_buckets - 1)];
+  while ((entry != NULL) && (strcmp(entry->key, key) != 0))
+    entry = entry->hnext;
+  if (entry == NULL)
+  {
+    __atomic_store_n(&cache->misses, cache->misses + 1, __ATOMIC_RELAXED);
+    return NULL;
+  }
+
+  if (now - entry->validated_at >= CACHE_REVALIDATE_SECS)
+  {
+    struct stat st;
+    if ((stat(entry->path, &st) != 0) || !same_file(entry, &st))
+    {
+      cache_remove(cache, entry);
+      __atomic_store_n(&cache->misses, cache->misses + 1, __ATOMIC_RELAXED);
+      return NULL;
+    }
+    entry->validated_at = now;
+  }
+
+  lru_unlink(cache, entry);
+  lru_push_front(cache, entry);
+  __atomic_store_n(&cache->hits, cache->hits + 1, __ATOMIC_RELAXED);
+  entry->refs++;
+  return entry;
+}
+
+/* the bytes an entry counts against the capacity */
+static size_t entry_charge(const char *key, const char *path, size_t blob_len)
+{
+  return sizeof(struct cache_entry) + blob_len + strlen(key) + strlen(path) + 2;
+}
+
+bool file_cache_fits(const struct file_cache *cache, const char *key, const char *path,
+                     size_t blob_len)
+{
+  return entry_charge(key, path, blob_len) <= cache->max_entry;
+}
+
+struct cache_entry *file_cache_insert(struct file_cache *cache, const char *key, const char *path,
+                                      const struct stat *st, char *blob, size_t blob_len, time_t now)
+{
+  size_t charge = entry_charge(key, path, blob_len);
+  if (charge > cache->max_entry)
+    return NULL;
+
+  struct cache_entry *entry = calloc(1, sizeof(struct cache_entry));
+  if (entry == NULL)
+    return NULL;
+  entry->key = strdup(key);
+  entry->path = strdup(path);
+  entry->refs = 1;
+  if ((entry->key == NULL) || (entry->path == NULL))
+  {
+    cache_entry_release(entry);
+    return NULL;
+  }
+  entry->blob = blob;
+  entry->blob_len = blob_len;
+  entry->mtime = st->st_mtim;
+  entry->size = st->st_size;
+  entry->ino = st->st_ino;
+  entry->validated_at = now;
+  entry->charge = charge;
+
+  // remember where the Date line is so senders can swap in the current one
+  char *headers_end = memmem(blob, blob_len, "\r\n\r\n", 4);
+  char *date = memmem(blob, headers_end == NULL ? 0 : headers_end - blob, "\r\nDate: ", 8);
+  if (date != NULL)
+  {
+    char *date_end = memmem(date + 2, headers_end + 2 - (date + 2), "\r\n", 2);
+    entry->date_off = date + 2 - blob;
+    entry->date_len = date_end + 2 - (date + 2);
+  }
+  // and the ETag, so conditional requests are answered without the file
+  char *etag = memmem(blob, headers_end == NULL ? 0 : headers_end - blob, "\r\nETag: ", 8);
+  if (etag != NULL)
+  {
+    char *etag_end = memmem(etag + 8, headers_end + 2 - (etag + 8), "\r\n", 2);
+    entry->etag_off = etag + 8 - blob;
+    entry->etag_len = etag_end - (etag + 8);
+  }
+
+  // a stale entry for the same key goes first, then the least recently used
+  struct cache_entry *old = cache->buckets[hash_key(key) & (cache->n_buckets - 1)];
+  while ((old != NULL) && (strcmp(old->key, key) != 0))
+    old = old->hnext;
+  if (old != NULL)
+    cache_remove(cache, old);
+  while ((cache->used + charge > cache->capacity) && (cache->tail != NULL))
+    cache_remove(cache, cache->tail);
+
+  if (cache->n_entries >= cache->n_buckets)
+    cache_grow(cache);
+  size_t b = hash_key(key) & (cache->n_buckets - 1);
+  entry->hnext = cache->buckets[b];
+  cache->buckets[b] = entry;
+  lru_push_front(cache, entry);
+  cache->used += charge;
+  cache->n_entries++;
+
+  // one reference for the cache, one for the caller
+  entry->refs++;
+  return entry;
+}
@@ -0,0 +1,47 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the HTTP course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the HTTP project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include <stdlib.h>
+#include <zlib.h>
+
+#include "gzip.h"
+
+char *gzip_compress(const char *data, size_t len, size_t reserve, size_t *out_len)
+{
+  z_stream strm;
+  strm.zalloc = Z_NULL;
+  strm.zfree = Z_NULL;
+  strm.opaque = Z_NULL;
+  // windowBits + 16 asks for a gzip header and trailer instead of zlib's
+  if (deflateInit2(&strm, GZIP_LEVEL, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    return NULL;
+
+  // deflateBound() is enough for a single Z_FINISH call to complete
+  size_t bound = deflateBound(&strm, len);
+  char *out = malloc(reserve + bound);
+  if (out == NULL)
+  {
+    deflateEnd(&strm);
+    return NULL;
+  }
+  strm.next_in = (Bytef *)data;
+  strm.avail_in = len;
+  strm.next_out = (Bytef *)out + reserve;
+  strm.avail_out = bound;
+  int err = deflate(&strm, Z_FINISH);
+  *out_len = strm.total_out;
+  deflateEnd(&strm);
+  if (err != Z_STREAM_END)
+  {
+    free(out);
+    return NULL;
+  }
+  return out;
+}
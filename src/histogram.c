@@ -0,0 +1,119 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the HTTP course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the HTTP project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "histogram.h"
+
+#define SUB_COUNT (1u << HISTOGRAM_SUB_BITS)
+#define HALF_COUNT (SUB_COUNT / 2)
+// Values under SUB_COUNT take the first SUB_COUNT buckets, every further
+// power of two HALF_COUNT more
+#define N_BUCKETS ((HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 2) * HALF_COUNT)
+#define MAX_VALUE ((1ull << HISTOGRAM_MAX_BITS) - 1)
+
+static size_t bucket_of(uint64_t value)
+{
+  if (value < SUB_COUNT)
+    return value;
+  int shift = 63 - __builtin_clzll(value) - (HISTOGRAM_SUB_BITS - 1);
+  return (size_t)(shift + 1) * HALF_COUNT + (value >> shift) - HALF_COUNT;
+}
+
+/* the largest value counted in a bucket */
+static uint64_t bucket_top(size_t bucket)
+{
+  if (bucket < SUB_COUNT)
+    return bucket;
+  int shift = bucket / HALF_COUNT - 1;
+  uint64_t sub = bucket % HALF_COUNT + HALF_COUNT;
+  return ((sub + 1) << shift) - 1;
+}
+
+bool histogram_init(struct histogram *hist)
+{
+  memset(hist, 0, sizeof(*hist));
+  hist->min = UINT64_MAX;
+  hist->counts = calloc(N_BUCKETS, sizeof(uint64_t));
+  return hist->counts != NULL;
+}
+
+/* there is a single writer, so relaxed loads and stores are enough for
+  histogram_merge() on another thread to never see a torn value */
+#define LOAD(__p) __atomic_load_n(__p, __ATOMIC_RELAXED)
+#define STORE(__p, __v) __atomic_store_n(__p, __v, __ATOMIC_RELAXED)
+
+void histogram_record(struct histogram *hist, uint64_t value, uint64_t count)
+{
+  if (value < hist->min)
+    STORE(&hist->min, value);
+  if (value > hist->max)
+    STORE(&hist->max, value);
+  double sum = hist->sum + (double)value * count;
+  __atomic_store(&hist->sum, &sum, __ATOMIC_RELAXED);
+  uint64_t *bucket = &hist->counts[bucket_of(value > MAX_VALUE ? MAX_VALUE : value)];
+  STORE(bucket, *bucket + count);
+  STORE(&hist->total, hist->total + count);
+}
+
+void histogram_merge(struct histogram *hist, const struct histogram *other)
+{
+  for (size_t i = 0; i < N_BUCKETS; i++)
+    hist->counts[i] += LOAD(&other->counts[i]);
+  hist->total += LOAD(&other->total);
+  double sum;
+  __atomic_load(&other->sum, &sum, __ATOMIC_RELAXED);
+  hist->sum += sum;
+  uint64_t min = LOAD(&other->min);
+  uint64_t max = LOAD(&other->max);
+  if (min < hist->min)
+    hist->min = min;
+  if (max > hist->max)
+    hist->max = max;
+}
+
+uint64_t histogram_quantile(const struct histogram *hist, double quantile)
+{
+  if (hist->total == 0)
+    return 0;
+  uint64_t rank = (uint64_t)(quantile * hist->total + 0.5);
+  if (rank < 1)
+    rank = 1;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < N_BUCKETS; i++)
+  {
+    seen += hist->counts[i];
+    if (seen >= rank)
+    {
+      uint64_t top = bucket_top(i);
+      // the extremes are known exactly
+      if (top > hist->max)
+        return hist->max;
+      return top < hist->min ? hist->min : top;
+    }
+  }
+  return hist->max;
+}
+
+void histogram_reset(struct histogram *hist)
+{
+  memset(hist->counts, 0, N_BUCKETS * sizeof(uint64_t));
+  hist->total = 0;
+  hist->min = UINT64_MAX;
+  hist->max = 0;
+  hist->sum = 0;
+}
+
+void histogram_destroy(struct histogram *hist)
+{
+  free(hist->counts);
+  hist->counts = NULL;
+}
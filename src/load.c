@@ -0,0 +1,628 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the HTTP course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the HTTP project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <ftw.h>
+#include <getopt.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "parse_http.h"
+#include "histogram.h"
+#include "load.h"
+#include "ports.h"
+
+#define DEFAULT_THREADS 2
+#define DEFAULT_CONNECTIONS 16
+#define DEFAULT_DURATION 10
+#define MAX_PIPELINE 64
+// Receive buffer of a connection, bodies are consumed as they arrive
+#define LOAD_BUF_SIZE (64 * 1024)
+
+//A request of the mix, serialized once up front
+struct load_request {
+  char *uri;
+  char *bytes;
+  size_t len;
+};
+
+//Everything the threads share, read-only once they run
+struct load_config {
+  struct sockaddr_in addr;
+  int threads;
+  int connections;
+  int pipeline;
+  double duration;              //!< Seconds to run for
+  double rate;                  //!< Requests per second over all threads, 0 for closed loop
+  struct load_request *requests;
+  size_t n_requests;
+  uint64_t start_ns;
+  uint64_t end_ns;
+};
+
+//A connection and the send times of its requests in flight, oldest first
+struct load_conn {
+  int fd;                       //!< -1 while not connected
+  uint64_t started[MAX_PIPELINE]; //!< When each request was sent, or was due to be
+  int head;
+  int count;
+  Http_response_parser parser;
+  char buf[LOAD_BUF_SIZE];      //!< Received bytes not consumed yet
+  size_t len;
+};
+
+//Errors, as wrk counts them
+struct load_errors {
+  uint64_t connect;
+  uint64_t read;                //!< The connection failed or was closed under requests
+  uint64_t write;
+  uint64_t parse;               //!< Malformed responses
+  uint64_t status;              //!< Responses other than 2xx and 3xx
+};
+
+struct load_thread {
+  pthread_t thread;
+  const struct load_config *cfg;
+  struct load_conn *conns;
+  int n_conns;
+  double interval_ns;           //!< Between two requests in open loop
+  uint64_t first_ns;            //!< When the first request is due in open loop
+  uint64_t scheduled;           //!< Requests sent in open loop
+  uint64_t next_ns;             //!< When the next one is due
+  uint64_t rng;                 //!< xorshift64 state for picking requests
+  struct histogram latency;     //!< In ns
+  uint64_t completed;
+  uint64_t bytes;
+  struct load_errors errors;
+};
+
+static uint64_t now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static const struct load_request *pick_request(struct load_thread *t)
+{
+  t->rng ^= t->rng << 13;
+  t->rng ^= t->rng >> 7;
+  t->rng ^= t->rng << 17;
+  return &t->cfg->requests[t->rng % t->cfg->n_requests];
+}
+
+static void conn_close(struct load_conn *conn)
+{
+  if (conn->fd >= 0)
+    close(conn->fd);
+  conn->fd = -1;
+  conn->head = 0;
+  conn->count = 0;
+  conn->len = 0;
+  response_parser_reset(&conn->parser);
+}
+
+static bool conn_open(struct load_thread *t, struct load_conn *conn)
+{
+  conn->fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (conn->fd < 0)
+    return false;
+  int one = 1;
+  setsockopt(conn->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  // requests are small, a send only blocks if the server stopped reading
+  struct timeval timeout = {1, 0};
+  setsockopt(conn->fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+  if (connect(conn->fd, (const struct sockaddr *)&t->cfg->addr, sizeof(t->cfg->addr)) < 0)
+  {
+    conn_close(conn);
+    t->errors.connect++;
+    return false;
+  }
+  return true;
+}
+
+/* sends up to n requests in one system call, all started at start or, with
+  start 0, now */
+static int conn_send(struct load_thread *t, struct load_conn *conn, int n, uint64_t start)
+{
+  if ((conn->fd < 0) && !conn_open(t, conn))
+    return 0;
+  struct iovec iov[MAX_PIPELINE];
+  size_t total = 0;
+  for (int i = 0; i < n; i++)
+  {
+    const struct load_request *req = pick_request(t);
+    iov[i].iov_base = req->bytes;
+    iov[i].iov_len = req->len;
+    total += req->len;
+  }
+  struct msghdr msg = {.msg_iov = iov, .msg_iovlen = n};
+  uint64_t sent_at = start != 0 ? start : now_ns();
+  while (total > 0)
+  {
+    ssize_t sent = sendmsg(conn->fd, &msg, MSG_NOSIGNAL);
+    if (sent < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      t->errors.write++;
+      conn_close(conn);
+      return 0;
+    }
+    total -= sent;
+    while ((sent > 0) && (msg.msg_iovlen > 0))
+    {
+      size_t step = (size_t)sent < msg.msg_iov->iov_len ? (size_t)sent : msg.msg_iov->iov_len;
+      msg.msg_iov->iov_base = (char *)msg.msg_iov->iov_base + step;
+      msg.msg_iov->iov_len -= step;
+      sent -= step;
+      if (msg.msg_iov->iov_len == 0)
+      {
+        msg.msg_iov++;
+        msg.msg_iovlen--;
+      }
+    }
+  }
+  for (int i = 0; i < n; i++)
+    conn->started[(conn->head + conn->count++) % MAX_PIPELINE] = sent_at;
+  return n;
+}
+
+/* parses what arrived, recording the latency of each complete response */
+static void conn_receive(struct load_thread *t, struct load_conn *conn)
+{
+  ssize_t n = recv(conn->fd, conn->buf + conn->len, sizeof(conn->buf) - conn->len, MSG_DONTWAIT);
+  if ((n < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)))
+    return;
+  uint64_t now = now_ns();
+  if (n <= 0)
+  {
+    t->errors.read++;
+    conn_close(conn);
+    return;
+  }
+  t->bytes += n;
+  conn->len += n;
+
+  size_t off = 0;
+  while (conn->count > 0)
+  {
+    size_t consumed;
+    test_error_code_t err = parse_http_response(&conn->parser, conn->buf + off, conn->len - off, &consumed);
+    off += consumed;
+    if (err == TEST_ERROR_PARSE_PARTIAL)
+      break;
+    if (err != TEST_ERROR_NONE)
+    {
+      t->errors.parse++;
+      conn_close(conn);
+      return;
+    }
+    // responses after the end are not counted, as if they never came
+    if (now <= t->cfg->end_ns)
+    {
+      histogram_record(&t->latency, now - conn->started[conn->head], 1);
+      t->completed++;
+      if ((conn->parser.status < 200) || (conn->parser.status >= 400))
+        t->errors.status++;
+    }
+    conn->head = (conn->head + 1) % MAX_PIPELINE;
+    conn->count--;
+    bool keep_alive = conn->parser.keep_alive;
+    response_parser_reset(&conn->parser);
+    if (!keep_alive)
+    {
+      // the requests behind it won't be answered
+      if (conn->count > 0)
+        t->errors.read++;
+      conn_close(conn);
+      return;
+    }
+  }
+  memmove(conn->buf, conn->buf + off, conn->len - off);
+  conn->len -= off;
+  // bytes nobody asked for, or a full buffer the parser took all it could
+  // of: recv() into no room would read as the server closing
+  if (((conn->count == 0) && (conn->len > 0)) || (conn->len == sizeof(conn->buf)))
+  {
+    t->errors.parse++;
+    conn_close(conn);
+  }
+}
+
+/* hands out due requests. closed loop keeps every connection full, open
+  loop sends on schedule wherever there is room. returns false if requests
+  are due but every connection is full */
+static bool fill_connections(struct load_thread *t)
+{
+  int depth = t->cfg->pipeline;
+  if (t->cfg->rate <= 0)
+  {
+    for (int i = 0; i < t->n_conns; i++)
+      if (t->conns[i].count < depth)
+        conn_send(t, &t->conns[i], depth - t->conns[i].count, 0);
+    return true;
+  }
+
+  // latency counts from when a request was due, not from when a free
+  // connection let it go out, so a stalled server can't hide its stalls
+  // by slowing the generator down (coordinated omission)
+  uint64_t now = now_ns();
+  for (int i = 0; (i < t->n_conns) && (t->next_ns <= now); i++)
+  {
+    struct load_conn *conn = &t->conns[i];
+    while ((conn->count < depth) && (t->next_ns <= now))
+    {
+      if (conn_send(t, conn, 1, t->next_ns) == 0)
+        break;
+      t->scheduled++;
+      t->next_ns = t->first_ns + (uint64_t)(t->scheduled * t->interval_ns);
+    }
+  }
+  return t->next_ns > now;
+}
+
+static void *load_thread_run(void *arg)
+{
+  struct load_thread *t = arg;
+  const struct load_config *cfg = t->cfg;
+  struct pollfd *pfds = calloc(t->n_conns, sizeof(struct pollfd));
+  if (pfds == NULL)
+    return NULL;
+
+  while (1)
+  {
+    uint64_t now = now_ns();
+    if (now >= cfg->end_ns)
+      break;
+    bool caught_up = fill_connections(t);
+
+    for (int i = 0; i < t->n_conns; i++)
+    {
+      pfds[i].fd = t->conns[i].count > 0 ? t->conns[i].fd : -1;
+      pfds[i].events = POLLIN;
+      pfds[i].revents = 0;
+    }
+    // wake up for the next request due, or the end. requests already due
+    // wait for a response to make room
+    uint64_t wake = cfg->end_ns;
+    if ((cfg->rate > 0) && caught_up && (t->next_ns < wake))
+      wake = t->next_ns;
+    now = now_ns();
+    uint64_t wait = wake > now ? wake - now : 0;
+    struct timespec timeout = {wait / 1000000000ull, wait % 1000000000ull};
+    int n = ppoll(pfds, t->n_conns, &timeout, NULL);
+    if (n < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    for (int i = 0; (i < t->n_conns) && (n > 0); i++)
+    {
+      if (pfds[i].revents == 0)
+        continue;
+      n--;
+      conn_receive(t, &t->conns[i]);
+    }
+  }
+  free(pfds);
+  return NULL;
+}
+
+static struct load_request *corpus;
+static size_t corpus_len;
+static size_t corpus_cap;
+static size_t corpus_root_len;
+
+/* every regular file under the corpus folder becomes a URI of the mix */
+static int add_corpus_file(const char *path, const struct stat *st, int type, struct FTW *ftw)
+{
+  if (type != FTW_F)
+    return 0;
+  const char *rel = path + corpus_root_len;
+  // the server doesn't decode percent-escapes, leave out what would need one
+  for (const char *p = rel; *p != '\0'; p++)
+    if ((*p <= ' ') || (*p == '%') || (*p == '?') || (*p == '#') || ((unsigned char)*p >= 0x7f))
+      return 0;
+  if (corpus_len == corpus_cap)
+  {
+    corpus_cap = corpus_cap == 0 ? 64 : 2 * corpus_cap;
+    struct load_request *grown = realloc(corpus, corpus_cap * sizeof(struct load_request));
+    if (grown == NULL)
+      return -1;
+    corpus = grown;
+  }
+  char *uri = malloc(strlen(rel) + 2);
+  if (uri == NULL)
+    return -1;
+  uri[0] = '/';
+  strcpy(uri + 1, *rel == '/' ? rel + 1 : rel);
+  corpus[corpus_len++] = (struct load_request){uri, NULL, 0};
+  return 0;
+}
+
+/* serializes each request of the mix once, so the threads only copy bytes */
+static bool serialize_requests(struct load_request *reqs, size_t n, const char *host)
+{
+  Request *request = calloc(1, sizeof(Request));
+  char *host_line = malloc(strlen(host) + 5);
+  char buf[HTTP_SIZE];
+  if ((request == NULL) || (host_line == NULL))
+  {
+    free(request);
+    free(host_line);
+    return false;
+  }
+  sprintf(host_line, "Host%s", host);
+  bool ok = true;
+  for (size_t i = 0; ok && (i < n); i++)
+  {
+    memset(request->known, -1, sizeof(request->known));
+    request->header_count = 0;
+    request->buf = host_line;
+    request_add_header(request, (Http_slice){0, 4}, (Http_slice){4, strlen(host)});
+    strcpy(request->http_method, GET);
+    // leave room for the method, version and headers
+    ok = strlen(reqs[i].uri) < sizeof(buf) - 256;
+    if (!ok)
+      break;
+    strcpy(request->http_uri, reqs[i].uri);
+    size_t len = 0; // serialize_http_request() adds to it
+    ok = (serialize_http_request(buf, &len, request) == TEST_ERROR_NONE) &&
+         ((reqs[i].bytes = malloc(len)) != NULL);
+    if (ok)
+    {
+      memcpy(reqs[i].bytes, buf, len);
+      reqs[i].len = len;
+    }
+  }
+  free(request);
+  free(host_line);
+  return ok;
+}
+
+static const double QUANTILES[] = {0.5, 0.75, 0.9, 0.95, 0.99, 0.999, 0.9999, 0.99999, 1.0};
+#define N_QUANTILES (sizeof(QUANTILES) / sizeof(QUANTILES[0]))
+
+static void print_report(FILE *out, const struct load_config *cfg, const char *host, double elapsed,
+                         const struct histogram *hist, uint64_t bytes, const struct load_errors *errors)
+{
+  fprintf(out, "%.2fs test @ %s:%d, %d threads, %d connections, pipeline %d, ", elapsed, host,
+          HTTP_PORT, cfg->threads, cfg->connections, cfg->pipeline);
+  if (cfg->rate > 0)
+    fprintf(out, "open loop at %.0f requests/s\n", cfg->rate);
+  else
+    fprintf(out, "closed loop\n");
+  fprintf(out, "  %llu requests, %.1f requests/s, %.2f MB read, %.2f MB/s\n",
+          (unsigned long long)hist->total, hist->total / elapsed, bytes / 1e6, bytes / 1e6 / elapsed);
+  fprintf(out, "  errors: connect %llu, read %llu, write %llu, parse %llu, status %llu\n",
+          (unsigned long long)errors->connect, (unsigned long long)errors->read,
+          (unsigned long long)errors->write, (unsigned long long)errors->parse,
+          (unsigned long long)errors->status);
+  if (hist->total == 0)
+    return;
+  fprintf(out, "  latency (us): min %.1f, mean %.1f, max %.1f\n", hist->min / 1e3,
+          hist->sum / hist->total / 1e3, hist->max / 1e3);
+  fprintf(out, "  %10s %12s\n", "percentile", "latency(us)");
+  for (size_t i = 0; i < N_QUANTILES; i++)
+    fprintf(out, "  %9.3f%% %12.1f\n", QUANTILES[i] * 100, histogram_quantile(hist, QUANTILES[i]) / 1e3);
+}
+
+static void print_json(FILE *out, const struct load_config *cfg, const char *host, double elapsed,
+                       const struct histogram *hist, uint64_t bytes, const struct load_errors *errors)
+{
+  fprintf(out, "{\"target\": \"%s:%d\", \"threads\": %d, \"connections\": %d, \"pipeline\": %d, ", host,
+          HTTP_PORT, cfg->threads, cfg->connections, cfg->pipeline);
+  fprintf(out, "\"mode\": \"%s\", \"rate\": %.0f, \"duration_s\": %.3f, ",
+          cfg->rate > 0 ? "open" : "closed", cfg->rate, elapsed);
+  fprintf(out, "\"requests\": %llu, \"requests_per_s\": %.1f, \"bytes\": %llu, ",
+          (unsigned long long)hist->total, hist->total / elapsed, (unsigned long long)bytes);
+  fprintf(out, "\"errors\": {\"connect\": %llu, \"read\": %llu, \"write\": %llu, \"parse\": %llu, "
+          "\"status\": %llu}, ", (unsigned long long)errors->connect, (unsigned long long)errors->read,
+          (unsigned long long)errors->write, (unsigned long long)errors->parse,
+          (unsigned long long)errors->status);
+  fprintf(out, "\"latency_us\": {\"min\": %.1f, \"mean\": %.1f, \"max\": %.1f, \"percentiles\": {",
+          hist->total ? hist->min / 1e3 : 0, hist->total ? hist->sum / hist->total / 1e3 : 0,
+          hist->max / 1e3);
+  for (size_t i = 0; i < N_QUANTILES; i++)
+    fprintf(out, "%s\"%g\": %.1f", i ? ", " : "", QUANTILES[i] * 100,
+            histogram_quantile(hist, QUANTILES[i]) / 1e3);
+  fprintf(out, "}}}\n");
+}
+
+static void usage()
+{
+  fprintf(stderr,
+          "usage: client load [--threads N] [--connections N] [--pipeline N] [--duration SECS]\n"
+          "       [--rate REQUESTS_PER_SEC] [--corpus DIR] [--json FILE] <server-ip>\n");
+}
+
+int load_main(int argc, char *argv[])
+{
+  static struct load_config cfg = {
+      .threads = DEFAULT_THREADS,
+      .connections = DEFAULT_CONNECTIONS,
+      .pipeline = 1,
+      .duration = DEFAULT_DURATION,
+  };
+  const char *corpus_dir = NULL;
+  const char *json_path = NULL;
+  static struct option long_options[] = {
+      {"threads", required_argument, NULL, 't'},
+      {"connections", required_argument, NULL, 'c'},
+      {"pipeline", required_argument, NULL, 'p'},
+      {"duration", required_argument, NULL, 'd'},
+      {"rate", required_argument, NULL, 'R'},
+      {"corpus", required_argument, NULL, 'C'},
+      {"json", required_argument, NULL, 'j'},
+      {NULL, 0, NULL, 0}};
+  int opt;
+  while ((opt = getopt_long(argc, argv, "t:c:p:d:R:C:j:", long_options, NULL)) != -1)
+  {
+    switch (opt)
+    {
+    case 't':
+      cfg.threads = atoi(optarg);
+      break;
+    case 'c':
+      cfg.connections = atoi(optarg);
+      break;
+    case 'p':
+      cfg.pipeline = atoi(optarg);
+      break;
+    case 'd':
+      cfg.duration = atof(optarg);
+      break;
+    case 'R':
+      cfg.rate = atof(optarg);
+      break;
+    case 'C':
+      corpus_dir = optarg;
+      break;
+    case 'j':
+      json_path = optarg;
+      break;
+    default:
+      usage();
+      return EXIT_FAILURE;
+    }
+  }
+  if ((optind != argc - 1) || (cfg.threads < 1) || (cfg.connections < cfg.threads) ||
+      (cfg.pipeline < 1) || (cfg.pipeline > MAX_PIPELINE) || (cfg.duration <= 0) || (cfg.rate < 0))
+  {
+    usage();
+    return EXIT_FAILURE;
+  }
+  const char *host = argv[optind];
+  cfg.addr.sin_family = AF_INET;
+  cfg.addr.sin_port = htons(HTTP_PORT);
+  if (inet_pton(AF_INET, host, &cfg.addr.sin_addr) != 1)
+  {
+    fprintf(stderr, "not an IPv4 address: %s\n", host);
+    return EXIT_FAILURE;
+  }
+
+  if (corpus_dir != NULL)
+  {
+    corpus_root_len = strlen(corpus_dir);
+    while ((corpus_root_len > 1) && (corpus_dir[corpus_root_len - 1] == '/'))
+      corpus_root_len--;
+    if (nftw(corpus_dir, add_corpus_file, 16, FTW_PHYS) != 0)
+    {
+      perror(corpus_dir);
+      return EXIT_FAILURE;
+    }
+    if (corpus_len == 0)
+    {
+      fprintf(stderr, "no files in %s\n", corpus_dir);
+      return EXIT_FAILURE;
+    }
+  }
+  else if (add_corpus_file("/", NULL, FTW_F, NULL) != 0)
+  {
+    return EXIT_FAILURE;
+  }
+  cfg.requests = corpus;
+  cfg.n_requests = corpus_len;
+  if (!serialize_requests(cfg.requests, cfg.n_requests, host))
+  {
+    fprintf(stderr, "couldn't serialize the requests\n");
+    return EXIT_FAILURE;
+  }
+
+  struct load_thread *threads = calloc(cfg.threads, sizeof(struct load_thread));
+  if (threads == NULL)
+    return EXIT_FAILURE;
+  cfg.start_ns = now_ns();
+  cfg.end_ns = cfg.start_ns + (uint64_t)(cfg.duration * 1e9);
+  for (int i = 0; i < cfg.threads; i++)
+  {
+    struct load_thread *t = &threads[i];
+    t->cfg = &cfg;
+    // connections spread as evenly as they go
+    t->n_conns = cfg.connections / cfg.threads + (i < cfg.connections % cfg.threads);
+    t->conns = calloc(t->n_conns, sizeof(struct load_conn));
+    if ((t->conns == NULL) || !histogram_init(&t->latency))
+      return EXIT_FAILURE;
+    for (int j = 0; j < t->n_conns; j++)
+    {
+      t->conns[j].fd = -1;
+      t->conns[j].parser.body_fd = -1;
+      response_parser_reset(&t->conns[j].parser);
+    }
+    t->rng = 0x9e3779b97f4a7c15ull * (i + 1);
+    if (cfg.rate > 0)
+    {
+      // threads take turns so the requests are evenly spaced overall
+      t->interval_ns = 1e9 * cfg.threads / cfg.rate;
+      t->first_ns = cfg.start_ns + (uint64_t)(t->interval_ns * i / cfg.threads);
+      t->next_ns = t->first_ns;
+    }
+    if (pthread_create(&t->thread, NULL, load_thread_run, t) != 0)
+    {
+      perror("pthread_create");
+      return EXIT_FAILURE;
+    }
+  }
+
+  struct histogram latency;
+  struct load_errors errors = {0};
+  uint64_t bytes = 0;
+  if (!histogram_init(&latency))
+    return EXIT_FAILURE;
+  for (int i = 0; i < cfg.threads; i++)
+  {
+    struct load_thread *t = &threads[i];
+    pthread_join(t->thread, NULL);
+    histogram_merge(&latency, &t->latency);
+    bytes += t->bytes;
+    errors.connect += t->errors.connect;
+    errors.read += t->errors.read;
+    errors.write += t->errors.write;
+    errors.parse += t->errors.parse;
+    errors.status += t->errors.status;
+    for (int j = 0; j < t->n_conns; j++)
+      if (t->conns[j].fd >= 0)
+        close(t->conns[j].fd);
+    free(t->conns);
+    histogram_destroy(&t->latency);
+  }
+  double elapsed = (now_ns() - cfg.start_ns) / 1e9;
+
+  print_report(stdout, &cfg, host, elapsed, &latency, bytes, &errors);
+  if (json_path != NULL)
+  {
+    FILE *out = strcmp(json_path, "-") == 0 ? stdout : fopen(json_path, "w");
+    if (out == NULL)
+    {
+      perror(json_path);
+      return EXIT_FAILURE;
+    }
+    print_json(out, &cfg, host, elapsed, &latency, bytes, &errors);
+    if (out != stdout)
+      fclose(out);
+  }
+  histogram_destroy(&latency);
+  free(threads);
+  return EXIT_SUCCESS;
+}
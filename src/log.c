@@ -0,0 +1,607 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the HTTP course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the HTTP project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <arpa/inet.h>
+
+#include "log.h"
+
+#define RING_MASK (LOG_RING_SIZE - 1)
+#define ALIGN8(__n) (((__n) + 7) & ~(size_t)7)
+#define CACHE_LINE 64
+
+int log_level = LOG_LEVEL_INFO;
+bool log_access_enabled = false;
+
+static const char *const LEVEL_NAMES[] = {"debug", "info", "warn", "error"};
+static const char *const LEVEL_TAGS[] = {"DEBUG", "INFO ", "WARN ", "ERROR"};
+
+enum record_kind
+{
+  RECORD_PAD,    // Fills the end of the ring, the next record is at its start
+  RECORD_TEXT,   // A log_write(), the arguments of fmt follow
+  RECORD_ACCESS, // A log_access()
+};
+
+/* start of every record in a ring. records are 8-byte aligned, the
+  arguments follow the header */
+struct log_record
+{
+  uint32_t size;   // Bytes of the record, without the padding to 8
+  uint8_t kind;
+  uint8_t level;
+  uint16_t thread; // Ring it came through
+  uint64_t time;   // CLOCK_REALTIME in ns
+  const char *fmt; // Format of a RECORD_TEXT, a string literal
+};
+
+/* records of one thread, on their way to the log thread. single producer,
+  single consumer: the thread only moves tail and the log thread only head,
+  both only grow and are taken modulo the size */
+struct log_ring
+{
+  size_t tail;
+  uint64_t dropped; // Records the thread found no room for
+  char pad1[CACHE_LINE - sizeof(size_t) - sizeof(uint64_t)];
+  size_t head;
+  uint64_t reported; // Drops reported so far, log thread only
+  char pad2[CACHE_LINE - sizeof(size_t) - sizeof(uint64_t)];
+  struct log_ring *next;
+  int id;
+  char buf[LOG_RING_SIZE];
+};
+
+/* every thread that logged, newest first. rings are never freed */
+static struct log_ring *rings;
+static int n_rings;
+static __thread struct log_ring *thread_ring;
+
+static bool started;
+static FILE *log_out;
+static FILE *access_out;
+
+/* one conversion of a printf() format */
+struct conv_spec
+{
+  const char *flags;
+  size_t n_flags;
+  const char *width; // Digits, or "*"
+  size_t n_width;
+  bool has_prec;
+  bool prec_star;
+  int prec;          // Digits after the '.', if not from an argument
+  char length;       // Length modifier, 'H' for hh and 'Q' for ll
+  char conv;         // Conversion character, '\0' at the end of the format
+};
+
+/* parses the conversion after a '%'. returns where the format goes on */
+static const char *parse_spec(const char *p, struct conv_spec *spec)
+{
+  spec->flags = p;
+  while ((*p != '\0') && (strchr("-+ #0'", *p) != NULL))
+    p++;
+  spec->n_flags = p - spec->flags;
+  spec->width = p;
+  if (*p == '*')
+    p++;
+  else
+    while ((*p >= '0') && (*p <= '9'))
+      p++;
+  spec->n_width = p - spec->width;
+  spec->has_prec = *p == '.';
+  spec->prec_star = false;
+  spec->prec = 0;
+  if (spec->has_prec)
+  {
+    p++;
+    if (*p == '*')
+    {
+      spec->prec_star = true;
+      p++;
+    }
+    while ((*p >= '0') && (*p <= '9'))
+      spec->prec = spec->prec * 10 + (*p++ - '0');
+  }
+  // the value is widened when it is stored, so the length only matters
+  // for reading it
+  spec->length = '\0';
+  if ((*p == 'h') || (*p == 'l'))
+  {
+    spec->length = *p++;
+    if (*p == spec->length)
+    {
+      spec->length = *p++ == 'h' ? 'H' : 'Q';
+    }
+  }
+  else if ((*p != '\0') && (strchr("jztLq", *p) != NULL))
+  {
+    spec->length = *p == 'q' ? 'Q' : *p;
+    p++;
+  }
+  spec->conv = *p;
+  if (*p != '\0')
+    p++;
+  return p;
+}
+
+/* appends n bytes of v to the record, unless they don't fit */
+static bool put(char *rec, size_t *pos, const void *v, size_t n)
+{
+  if (*pos + n > LOG_RECORD_MAX)
+    return false;
+  memcpy(rec + *pos, v, n);
+  *pos += n;
+  return true;
+}
+
+/* copies the arguments fmt uses behind the header. strings are copied
+  whole, up to their precision, as the caller may reuse them right away.
+  stops at a conversion it doesn't know or once the record is full; the
+  formatter stops at the same place */
+static void encode(struct log_record *rec, const char *fmt, va_list ap)
+{
+  char *buf = (char *)rec;
+  size_t pos = sizeof(struct log_record);
+  const char *p = fmt;
+  bool ok = true;
+  while (ok && (*p != '\0'))
+  {
+    if (*p++ != '%')
+      continue;
+    struct conv_spec spec;
+    p = parse_spec(p, &spec);
+    if (spec.conv == '%')
+      continue;
+    if ((spec.n_width == 1) && (spec.width[0] == '*'))
+    {
+      int width = va_arg(ap, int);
+      ok = put(buf, &pos, &width, sizeof(width));
+    }
+    int prec = spec.has_prec ? spec.prec : -1;
+    if (spec.prec_star)
+    {
+      prec = va_arg(ap, int);
+      ok = ok && put(buf, &pos, &prec, sizeof(prec));
+    }
+    uint64_t v;
+    double d;
+    switch (spec.conv)
+    {
+    case 'd':
+    case 'i':
+      switch (spec.length)
+      {
+      case 'H': v = (signed char)va_arg(ap, int); break;
+      case 'h': v = (short)va_arg(ap, int); break;
+      case 'l': v = va_arg(ap, long); break;
+      case 'Q': v = va_arg(ap, long long); break;
+      case 'z': v = va_arg(ap, ssize_t); break;
+      case 'j': v = va_arg(ap, intmax_t); break;
+      case 't': v = va_arg(ap, ptrdiff_t); break;
+      default: v = va_arg(ap, int); break;
+      }
+      ok = ok && put(buf, &pos, &v, sizeof(v));
+      break;
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+      switch (spec.length)
+      {
+      case 'H': v = (unsigned char)va_arg(ap, unsigned); break;
+      case 'h': v = (unsigned short)va_arg(ap, unsigned); break;
+      case 'l': v = va_arg(ap, unsigned long); break;
+      case 'Q': v = va_arg(ap, unsigned long long); break;
+      case 'z': v = va_arg(ap, size_t); break;
+      case 'j': v = va_arg(ap, uintmax_t); break;
+      case 't': v = va_arg(ap, ptrdiff_t); break;
+      default: v = va_arg(ap, unsigned); break;
+      }
+      ok = ok && put(buf, &pos, &v, sizeof(v));
+      break;
+    case 'c':
+      v = va_arg(ap, int);
+      ok = ok && put(buf, &pos, &v, sizeof(v));
+      break;
+    case 'p':
+      v = (uintptr_t)va_arg(ap, void *);
+      ok = ok && put(buf, &pos, &v, sizeof(v));
+      break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+      d = spec.length == 'L' ? (double)va_arg(ap, long double) : va_arg(ap, double);
+      ok = ok && put(buf, &pos, &d, sizeof(d));
+      break;
+    case 's':
+    {
+      const char *s = va_arg(ap, const char *);
+      if (s == NULL)
+        s = "(null)";
+      size_t len = prec >= 0 ? strnlen(s, prec) : strlen(s);
+      size_t room = LOG_RECORD_MAX - pos;
+      room = room > sizeof(uint32_t) ? room - sizeof(uint32_t) : 0;
+      uint32_t n = len < room ? len : room;
+      ok = ok && put(buf, &pos, &n, sizeof(n)) && put(buf, &pos, s, n);
+      break;
+    }
+    default:
+      ok = false;
+      break;
+    }
+  }
+  rec->size = pos;
+}
+
+/* reads the arguments of a record back in the order encode() wrote them */
+struct decoder
+{
+  const char *p;
+  const char *end;
+};
+
+static bool get(struct decoder *dec, void *v, size_t n)
+{
+  if (dec->p + n > dec->end)
+    return false;
+  memcpy(v, dec->p, n);
+  dec->p += n;
+  return true;
+}
+
+/* appends what snprintf() wrote to out, keeping len below cap */
+static size_t advance(size_t len, int n, size_t cap)
+{
+  if (n < 0)
+    return len;
+  return len + n < cap ? len + n : cap - 1;
+}
+
+/* formats fmt with the record's arguments. every conversion is printed on
+  its own, with its length modifier replaced by the width it was stored in */
+static size_t format_text(const struct log_record *rec, char *out, size_t len, size_t cap)
+{
+  struct decoder dec = {(const char *)(rec + 1), (const char *)rec + rec->size};
+  const char *p = rec->fmt;
+  while ((*p != '\0') && (len < cap - 1))
+  {
+    if (*p != '%')
+    {
+      out[len++] = *p++;
+      continue;
+    }
+    struct conv_spec spec;
+    p = parse_spec(p + 1, &spec);
+    if (spec.conv == '%')
+    {
+      out[len++] = '%';
+      continue;
+    }
+
+    char cs[64];
+    size_t n = 0;
+    cs[n++] = '%';
+    if (spec.n_flags > 8)
+      spec.n_flags = 8;
+    memcpy(cs + n, spec.flags, spec.n_flags);
+    n += spec.n_flags;
+    int width;
+    if ((spec.n_width == 1) && (spec.width[0] == '*'))
+    {
+      if (!get(&dec, &width, sizeof(width)))
+        break;
+      n += sprintf(cs + n, "%d", width);
+    }
+    else if (spec.n_width > 0)
+    {
+      n += sprintf(cs + n, "%.*s", spec.n_width > 10 ? 10 : (int)spec.n_width, spec.width);
+    }
+    int prec = spec.prec;
+    if (spec.prec_star && !get(&dec, &prec, sizeof(prec)))
+      break;
+    // strings were cut to their precision when they were copied
+    if (spec.has_prec && (prec >= 0) && (spec.conv != 's'))
+      n += sprintf(cs + n, ".%d", prec);
+
+    uint64_t v;
+    double d;
+    uint32_t slen;
+    int w = -1;
+    switch (spec.conv)
+    {
+    case 'd':
+    case 'i':
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+      if (!get(&dec, &v, sizeof(v)))
+        break;
+      sprintf(cs + n, "ll%c", spec.conv);
+      if ((spec.conv == 'd') || (spec.conv == 'i'))
+        w = snprintf(out + len, cap - len, cs, (long long)v);
+      else
+        w = snprintf(out + len, cap - len, cs, (unsigned long long)v);
+      break;
+    case 'c':
+      if (!get(&dec, &v, sizeof(v)))
+        break;
+      sprintf(cs + n, "c");
+      w = snprintf(out + len, cap - len, cs, (int)v);
+      break;
+    case 'p':
+      if (!get(&dec, &v, sizeof(v)))
+        break;
+      sprintf(cs + n, "p");
+      w = snprintf(out + len, cap - len, cs, (void *)(uintptr_t)v);
+      break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+      if (!get(&dec, &d, sizeof(d)))
+        break;
+      sprintf(cs + n, "%c", spec.conv);
+      w = snprintf(out + len, cap - len, cs, d);
+      break;
+    case 's':
+      if (!get(&dec, &slen, sizeof(slen)) || (dec.p + slen > dec.end))
+        break;
+      sprintf(cs + n, ".*s");
+      w = snprintf(out + len, cap - len, cs, (int)slen, dec.p);
+      dec.p += slen;
+      break;
+    default:
+      break;
+    }
+    if (w < 0)
+      break;
+    len = advance(len, w, cap);
+  }
+  return len;
+}
+
+/* local time of a record, through strftime() */
+static size_t format_time(uint64_t ns, const char *format, char *out, size_t cap)
+{
+  time_t secs = ns / 1000000000;
+  struct tm tm;
+  localtime_r(&secs, &tm);
+  return strftime(out, cap, format, &tm);
+}
+
+/* the line of a record, with its newline */
+static size_t format_record(const struct log_record *rec, char *out, size_t cap)
+{
+  size_t len;
+  if (rec->kind == RECORD_ACCESS)
+  {
+    struct decoder dec = {(const char *)(rec + 1), (const char *)rec + rec->size};
+    uint32_t addr;
+    int32_t status;
+    uint64_t bytes;
+    uint32_t line_len;
+    if (!get(&dec, &addr, sizeof(addr)) || !get(&dec, &status, sizeof(status)) ||
+        !get(&dec, &bytes, sizeof(bytes)) || !get(&dec, &line_len, sizeof(line_len)) ||
+        (dec.p + line_len > dec.end))
+      return 0;
+    char ip[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &addr, ip, sizeof(ip));
+    char date[40];
+    format_time(rec->time, "%d/%b/%Y:%H:%M:%S %z", date, sizeof(date));
+    char size[24] = "-";
+    if (bytes > 0)
+      snprintf(size, sizeof(size), "%llu", (unsigned long long)bytes);
+    len = advance(0, snprintf(out, cap, "%s - - [%s] \"%.*s\" %d %s", ip, date,
+                              line_len > 0 ? (int)line_len : 1,
+                              line_len > 0 ? dec.p : "-", status, size), cap);
+  }
+  else
+  {
+    len = format_time(rec->time, "%Y-%m-%d %H:%M:%S", out, cap);
+    len = advance(len, snprintf(out + len, cap - len, ".%06u %s [t%u] ",
+                                (unsigned)(rec->time % 1000000000 / 1000),
+                                LEVEL_TAGS[rec->level], rec->thread), cap);
+    len = format_text(rec, out, len, cap);
+  }
+  out[len++] = '\n';
+  return len;
+}
+
+/* the calling thread's ring, set up the first time it logs */
+static struct log_ring *get_ring()
+{
+  if (thread_ring != NULL)
+    return thread_ring;
+  struct log_ring *ring = calloc(1, sizeof(struct log_ring));
+  if (ring == NULL)
+    return NULL;
+  ring->id = __atomic_fetch_add(&n_rings, 1, __ATOMIC_RELAXED);
+  ring->next = __atomic_load_n(&rings, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(&rings, &ring->next, ring, false, __ATOMIC_RELEASE,
+                                      __ATOMIC_RELAXED))
+  {
+  }
+  thread_ring = ring;
+  return ring;
+}
+
+/* copies the record into the thread's ring, or counts it as dropped if the
+  log thread has fallen that far behind. never blocks */
+static void submit(struct log_record *rec)
+{
+  if (!__atomic_load_n(&started, __ATOMIC_ACQUIRE))
+  {
+    char line[LOG_LINE_MAX];
+    fwrite(line, 1, format_record(rec, line, sizeof(line)), stderr);
+    return;
+  }
+  struct log_ring *ring = get_ring();
+  if (ring == NULL)
+    return;
+  rec->thread = ring->id;
+  size_t size = ALIGN8(rec->size);
+  size_t tail = ring->tail;
+  size_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+  size_t off = tail & RING_MASK;
+  size_t to_end = LOG_RING_SIZE - off;
+  // records are never split, one that doesn't fit at the end goes to the
+  // start behind a padding record
+  size_t need = size <= to_end ? size : to_end + size;
+  if (LOG_RING_SIZE - (tail - head) < need)
+  {
+    __atomic_store_n(&ring->dropped, ring->dropped + 1, __ATOMIC_RELAXED);
+    return;
+  }
+  if (size > to_end)
+  {
+    struct log_record *pad = (struct log_record *)(ring->buf + off);
+    pad->size = to_end;
+    pad->kind = RECORD_PAD;
+    tail += to_end;
+    off = 0;
+  }
+  memcpy(ring->buf + off, rec, rec->size);
+  // the log thread may read the record as soon as it sees the new tail
+  __atomic_store_n(&ring->tail, tail + size, __ATOMIC_RELEASE);
+}
+
+static uint64_t now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+int log_parse_level(const char *name)
+{
+  for (int i = 0; i < (int)(sizeof(LEVEL_NAMES) / sizeof(LEVEL_NAMES[0])); i++)
+    if (strcmp(name, LEVEL_NAMES[i]) == 0)
+      return i;
+  return -1;
+}
+
+void log_write(int level, const char *fmt, ...)
+{
+  uint64_t buf[LOG_RECORD_MAX / sizeof(uint64_t)];
+  struct log_record *rec = (struct log_record *)buf;
+  rec->kind = RECORD_TEXT;
+  rec->level = level;
+  rec->thread = 0;
+  rec->time = now_ns();
+  rec->fmt = fmt;
+  va_list ap;
+  va_start(ap, fmt);
+  encode(rec, fmt, ap);
+  va_end(ap);
+  submit(rec);
+}
+
+void log_access(uint32_t addr, const char *request_line, size_t line_len, int status,
+                size_t bytes)
+{
+  if (!log_access_enabled)
+    return;
+  uint64_t buf[LOG_RECORD_MAX / sizeof(uint64_t)];
+  struct log_record *rec = (struct log_record *)buf;
+  rec->kind = RECORD_ACCESS;
+  rec->level = LOG_LEVEL_INFO;
+  rec->thread = 0;
+  rec->time = now_ns();
+  rec->fmt = NULL;
+  size_t pos = sizeof(struct log_record);
+  int32_t code = status;
+  uint64_t size = bytes;
+  size_t room = LOG_RECORD_MAX - pos - 3 * sizeof(uint32_t) - sizeof(uint64_t);
+  uint32_t len = request_line == NULL ? 0 : line_len < room ? line_len : room;
+  put((char *)buf, &pos, &addr, sizeof(addr));
+  put((char *)buf, &pos, &code, sizeof(code));
+  put((char *)buf, &pos, &size, sizeof(size));
+  put((char *)buf, &pos, &len, sizeof(len));
+  put((char *)buf, &pos, request_line, len);
+  rec->size = pos;
+  submit(rec);
+}
+
+/* drains every ring in turn, sleeping when they are all empty. lines of
+  different threads are ordered by when they are drained, each carries the
+  time it was logged at */
+static void *log_run(void *arg)
+{
+  char line[LOG_LINE_MAX];
+  while (1)
+  {
+    bool busy = false;
+    for (struct log_ring *ring = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); ring != NULL;
+         ring = ring->next)
+    {
+      size_t head = ring->head;
+      size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+      if (head != tail)
+        busy = true;
+      while (head != tail)
+      {
+        const struct log_record *rec = (const struct log_record *)(ring->buf + (head & RING_MASK));
+        if (rec->kind == RECORD_ACCESS)
+          fwrite(line, 1, format_record(rec, line, sizeof(line)), access_out);
+        else if (rec->kind == RECORD_TEXT)
+          fwrite(line, 1, format_record(rec, line, sizeof(line)), log_out);
+        head += ALIGN8(rec->size);
+      }
+      __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+
+      uint64_t dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+      if (dropped != ring->reported)
+      {
+        size_t len = format_time(now_ns(), "%Y-%m-%d %H:%M:%S", line, sizeof(line));
+        fprintf(log_out, "%.*s %s [t%d] dropped %llu log records, the ring was full\n",
+                (int)len, line, LEVEL_TAGS[LOG_LEVEL_WARN], ring->id,
+                (unsigned long long)(dropped - ring->reported));
+        ring->reported = dropped;
+      }
+    }
+    if (!busy)
+    {
+      fflush(log_out);
+      if (access_out != NULL)
+        fflush(access_out);
+      struct timespec idle = {0, LOG_IDLE_NS};
+      nanosleep(&idle, NULL);
+    }
+  }
+  return NULL;
+}
+
+bool log_start(FILE *out, FILE *access)
+{
+  log_out = out;
+  access_out = access;
+  log_access_enabled = access != NULL;
+  pthread_t thread;
+  if (pthread_create(&thread, NULL, log_run, NULL) != 0)
+    return false;
+  pthread_detach(thread);
+  __atomic_store_n(&started, true, __ATOMIC_RELEASE);
+  return true;
+}
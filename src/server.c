@@ -8,6 +8,7 @@
  * No part of the HTTP project may be copied and/or distributed
  * without the express permission of the 15-441/641 course staff.
  */
+#define _GNU_SOURCE
 #include <netinet/in.h>
 #include <netinet/ip.h>
 #include <netinet/tcp.h>
@@ -29,16 +30,79 @@
 
 #include "parse_http.h"
 #include "ports.h"
-#include <poll.h>
+#include "file_cache.h"
+#include "fast_parse.h"
+#include "uring.h"
+#include "gzip.h"
+#include "dir_listing.h"
+#include "stats.h"
+#include "log.h"
+#include "timer_wheel.h"
+#include "admission.h"
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+#include <signal.h>
+#include <pthread.h>
+#include <getopt.h>
 
 #include <limits.h>
 
-#define BUF_SIZE 999999
-// Closes a client's connection if they have not sent a valid request within
-// CONNECTION_TIMEOUT seconds.
+// Initial size of a connection's receive buffer, it doubles as needed
+#define RECV_BUF_INIT 4096
+// A single request (headers and body) must fit in this many bytes
+#define MAX_RECV_BUF (16 * 1024 * 1024)
+// Deadlines of a connection in seconds, see enum deadline. An idle
+// keep-alive connection is closed if it sends no request for
+// CONNECTION_TIMEOUT seconds; a request's headers have HEADER_TIMEOUT from
+// its first bytes and its body BODY_TIMEOUT from the end of the headers.
 #define CONNECTION_TIMEOUT 50
+#define HEADER_TIMEOUT 10
+#define BODY_TIMEOUT 30
 
-#define MAX_CONCURRENT_CONNS 100
+// Default limit on open connections, split evenly between the workers.
+// Connection state is allocated per connection, so this only bounds memory
+// and fds, not a table size.
+#define MAX_CONCURRENT_CONNS 65536
+// Default length of each worker's queue of connections waiting for accept()
+#define LISTEN_BACKLOG 4096
+// Connections accepted per round of the event loop, the rest of the accept
+// queue waits for the next round so the open ones aren't starved
+#define ACCEPT_BATCH 64
+// Seconds a client that is turned away is asked to wait in Retry-After
+#define SHED_RETRY_AFTER 1
+
+// Number of ready events handled per epoll_wait() call
+#define MAX_EVENTS 1024
+
+#define MAX_WORKERS 256
+
+// Responses to pipelined requests are coalesced into a single sendmsg() of
+// at most MAX_BATCH_IOV buffers, flushed early once OUTPUT_BUDGET bytes are
+// queued
+#define MAX_BATCH_IOV 64
+#define OUTPUT_BUDGET (256 * 1024)
+// A connection with more than OUT_HIGH_WATERMARK bytes of output queued
+// takes no new requests until the client has read it down to
+// OUT_LOW_WATERMARK
+#define OUT_HIGH_WATERMARK (1024 * 1024)
+#define OUT_LOW_WATERMARK (256 * 1024)
+// Initial number of items of a connection's output queue, it doubles as
+// needed
+#define OUT_QUEUE_INIT 16
+
+// Default size of the response cache, split evenly between the workers
+#define DEFAULT_CACHE_MB 64
+
+// Room for the headers of one part of a multipart/byteranges response
+#define RANGE_PART_HEADER_MAX 160
+
+// Body bytes a streamed response produces at a time
+#define STREAM_CHUNK_SIZE (16 * 1024)
+
+// Cache key suffix of gzip variants, request URIs never contain spaces
+#define GZIP_KEY_SUFFIX " gzip"
 
 #define HOSTLEN 256
 #define SERVLEN 8
@@ -49,15 +113,169 @@
 #define TCP_USER_TIMEOUT 18
 #endif
 
+/* read-only once the workers are started, shared by all of them */
+struct server_config
+{
+  char *www_folder;   // Folder the files are served from
+  int n_workers;      // Number of worker threads
+  size_t cache_bytes; // Response cache size of each worker, 0 disables it
+  bool use_uring;     // Read cache misses through io_uring when the kernel has it
+  bool autoindex;     // List directories that have no index file
+  struct worker_stats *stats; // Counters of every worker, indexed by id
+  int stats_interval; // Seconds between dumps of the counters to stats_file
+  char *stats_file;   // File the counters are dumped to, NULL for none
+  size_t max_conns;   // Open connections each worker takes, its share of the limit
+  int backlog;        // Length of each worker's accept queue
+  struct admission *admission; // Limits per client address, NULL for none
+};
+
+/* a piece of a response in a connection's output queue: memory, or a range
+  of a file that is sent with sendfile() */
+struct out_item
+{
+  char *buf;               // Unsent memory, NULL for a file range
+  size_t len;              // Unsent bytes
+  int fd;                  // File of a range, -1 for memory
+  off_t offset;            // Where the unsent part of the range starts
+  bool close_fd;           // Close fd once the range is sent
+  void *owned;             // free()d once the item is sent, NULL if none
+  struct cache_entry *ref; // Released once the item is sent, NULL if none
+};
+
+/* responses waiting for room in a connection's send buffer, oldest first.
+  items[head] to items[count] are in use */
+struct out_queue
+{
+  struct out_item *items; // NULL until the first response is queued
+  size_t head;
+  size_t count;
+  size_t cap;
+  size_t bytes; // Unsent bytes of all items
+  bool failed;  // An item was lost to a lack of memory or a send failed, the rest is dropped
+};
+
+/* every worker owns a listening socket (the kernel spreads accepts across
+  them with SO_REUSEPORT), an epoll instance and its connections. nothing in
+  here is touched by other threads */
+struct worker
+{
+  int id;
+  pthread_t thread;
+  const struct server_config *config;
+  int listenfd;      // This worker's listening socket
+  int epfd;          // This worker's epoll instance
+  struct worker_stats *stats; // This worker's counters, config->stats[id]
+  struct file_cache *cache; // Serialized responses, NULL if disabled
+  struct uring *ring;       // Asynchronous file I/O, NULL for synchronous
+  struct timer_wheel timers; // Deadlines of the connections
+  bool accept_ready; // The accept queue may not be drained yet
+  char shed_msg[RESPONSE_HEADER_MAX]; // The 503 load is shed with
+  size_t shed_len;
+  time_t shed_when;  // When shed_msg was rendered
+  struct stats_scratch *stats_scratch; // Room to answer STATS_URI in, NULL until it is asked for
+};
+
+/* what a connection's timer is waiting for */
+enum deadline
+{
+  DEADLINE_NONE,   // nothing, it is parked on file I/O
+  DEADLINE_IDLE,   // the next request, CONNECTION_TIMEOUT
+  DEADLINE_HEADER, // the rest of a request's headers, HEADER_TIMEOUT
+  DEADLINE_BODY,   // the rest of a request's body, BODY_TIMEOUT
+  DEADLINE_SEND,   // room for more of the queued output, CONNECTION_TIMEOUT
+};
+
+static const uint64_t DEADLINE_MS[] = {
+    [DEADLINE_IDLE] = CONNECTION_TIMEOUT * 1000,
+    [DEADLINE_HEADER] = HEADER_TIMEOUT * 1000,
+    [DEADLINE_BODY] = BODY_TIMEOUT * 1000,
+    [DEADLINE_SEND] = CONNECTION_TIMEOUT * 1000,
+};
+
+/* steps of reading a file through the ring */
+enum job_state
+{
+  JOB_IDLE, // no file I/O in flight, the connection is handled normally
+  JOB_OPEN,
+  JOB_STAT,
+  JOB_READ,
+};
+
+/* a cache miss being served through io_uring. the connection is parked
+  meanwhile: nothing else is read from it or sent to it */
+struct file_job
+{
+  enum job_state state;
+  char *path;         // File opened, in the arena
+  char *key;          // Request URI the response is cached under, in the arena
+  bool dir_retry;     // path named a directory and INDEX_FILE was appended
+  int fd;             // Open file, -1 if none
+  struct statx stx;   // Filled in by the statx completion
+  char head[RESPONSE_HEADER_MAX];
+  char *buf;          // Whole response, malloc()ed when it is going to be cached
+  size_t len;         // Length of buf
+  size_t done;        // Bytes of buf filled in so far
+  bool cacheable;     // buf is handed to the cache once it is complete
+  uint64_t started;   // stats_now() when the job started
+};
+
+/* writes the next piece of a streamed body to buf, at most cap bytes.
+  returns how many, 0 once the body is complete and -1 on errors */
+typedef ssize_t (*stream_produce_fn)(void *state, char *buf, size_t cap);
+
+/* a response of unknown length, sent with Transfer-Encoding: chunked while
+  it is produced. the producer is only asked for more once the socket took
+  the previous chunk, so a stream holds one chunk however slow the client.
+  the connection is parked until it is complete */
+struct response_stream
+{
+  stream_produce_fn produce;
+  void (*release)(void *state); // Frees state once the stream ends
+  void *state;
+  Http_status status; // Of the response, counted when it ends
+  char *out;          // Unsent part of buf
+  size_t out_len;
+  bool done;          // The last chunk is in buf
+  char buf[CHUNK_HEADER_MAX + STREAM_CHUNK_SIZE + 8]; // One framed chunk
+};
+
 struct client_info
 {
+  struct worker *worker;   // Worker owning the connection
   struct sockaddr_in addr; // Socket address
   socklen_t addrlen;       // Socket address length
   int connfd;              // Client connection file descriptor
   char host[HOSTLEN];      // Client host
   char serv[SERVLEN];      // Client service (port)
+  char *recv_buf;          // Bytes received but not handled yet
+  size_t recv_start;       // Start of the first unhandled request in recv_buf
+  size_t recv_len;         // Bytes of recv_buf in use
+  size_t recv_cap;         // Allocated size of recv_buf
+  size_t scan_offset;      // Where the CRLFCRLF scan of the current request resumes
+  struct arena arena;      // Memory of the requests whose responses are queued
+  struct out_queue out;    // Responses the socket hasn't taken yet
+  bool want_out;           // Registered for EPOLLOUT, some of out is waiting for room
+  bool backed_up;          // out is past the high watermark, no requests are taken
+  struct file_job job;     // File read in flight, if any
+  struct response_stream *stream; // Streamed response being sent, NULL if none
+  bool close_after;        // Close once the responses in flight are sent
+  Stats_method method;     // Method of the request being answered, for the stats
+  char *request_line;      // Its request line for the access log, in the arena, NULL if none
+  size_t request_line_len;
+  size_t queued;           // Response bytes queued on the connection so far
+  size_t response_start;   // queued when the current response was started
+  struct timer timer;      // In worker->timers while a deadline runs
+  enum deadline deadline;  // What the timer is for
+  bool admitted;           // Counted against its address by config->admission
 };
 
+/* client_update() return values */
+#define CLIENT_CLOSE 0    // connection should be closed
+#define CLIENT_KEEP 1     // keep alive, wait for more data
+#define CLIENT_PROGRESS 2 // handled a request, more may already be buffered
+#define CLIENT_PARKED 3   // waiting for file I/O, resumed on its completion
+#define CLIENT_BLOCKED 4  // output is backed up, resumed once the client reads
+
 #define ERR(msg, __VA_ARGS__) \
   if (__VA_ARGS__)            \
   {                           \
@@ -71,303 +289,2180 @@ struct client_info
     return -1;                \
   }
 
-int new_connection(int sockfd, struct pollfd *poll_list,
-                   struct client_info *client_info_list)
+/* starts the connection's timer for deadline. a deadline that is already
+  running keeps its expiry, so a client trickling a request in byte by byte
+  doesn't push it back; DEADLINE_SEND alone restarts, it runs from the last
+  time the socket took data */
+void client_deadline(struct client_info *client_info, enum deadline deadline)
+{
+  struct timer_wheel *timers = &client_info->worker->timers;
+  if (deadline == DEADLINE_NONE)
+    timer_cancel(timers, &client_info->timer);
+  else if ((deadline != client_info->deadline) || (deadline == DEADLINE_SEND) ||
+           !timer_armed(&client_info->timer))
+    timer_arm(timers, &client_info->timer, DEADLINE_MS[deadline]);
+  client_info->deadline = deadline;
+}
+
+/* the 503 load is shed with, rendered again when the second of its Date
+  changes. the client is asked to come back after SHED_RETRY_AFTER seconds,
+  unless that doesn't fit; then it is the plain 503 */
+const char *shed_response(struct worker *worker, size_t *len)
+{
+  time_t now = time(NULL);
+  if ((worker->shed_len == 0) || (worker->shed_when != now))
+  {
+    size_t header_len = serialize_response_header(worker->shed_msg, HTTP_503, NULL, 0, NULL,
+                                                  RESPONSE_CLOSE);
+    worker->shed_len = response_add_header(worker->shed_msg, header_len, "Retry-After: %d",
+                                           SHED_RETRY_AFTER);
+    worker->shed_when = now;
+  }
+  if (worker->shed_len == 0)
+    return error_response(HTTP_503, len);
+  *len = worker->shed_len;
+  return worker->shed_msg;
+}
+
+/* turns a connection away before anything is allocated for it. its request
+  is never parsed, but what already arrived of it is drained: closing a
+  socket with unread data resets the connection, and the 503 with it */
+void shed_connection(struct worker *worker, int fd)
+{
+  size_t msg_len;
+  const char *msg = shed_response(worker, &msg_len);
+  send(fd, msg, msg_len, MSG_DONTWAIT | MSG_NOSIGNAL);
+  shutdown(fd, SHUT_WR);
+  char sink[2048];
+  for (int i = 0; (i < 4) && (recv(fd, sink, sizeof(sink), MSG_DONTWAIT) > 0); i++)
+  {
+  }
+  close(fd);
+}
+
+/* accepts one pending connection on the worker's listening socket and
+  registers it with its epoll instance, unless the worker is full or the
+  client's address is over its limits. returns -1 once the accept queue is
+  drained */
+int new_connection(struct worker *worker)
 {
-  printf("received connection!\n");
   struct sockaddr_in client_addr;
   socklen_t client_addrlen = sizeof(client_addr);
-  int client_sockfd = accept(sockfd, (struct sockaddr *)&client_addr,
-                             &client_addrlen);
+  // non-blocking, a client that doesn't read must not stall the worker
+  int client_sockfd = accept4(worker->listenfd, (struct sockaddr *)&client_addr,
+                              &client_addrlen, SOCK_NONBLOCK);
   if (client_sockfd < 0)
   {
-    // skip
-    printf("coult not accept new connection\n");
+    // EAGAIN just means the listen queue is empty
+    if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+      LOG_WARN("could not accept new connection: %s", strerror(errno));
     return -1;
   }
-  size_t i = 0;
-  for (; (i < MAX_CONCURRENT_CONNS) && (poll_list[i].fd >= 0);
-       i++)
+  stats_add(&worker->stats->accepted, 1);
+  if (worker->stats->active >= worker->config->max_conns)
   {
+    LOG_DEBUG("worker %d: %llu connections open, shedding fd %d", worker->id,
+              (unsigned long long)worker->stats->active, client_sockfd);
+    stats_add(&worker->stats->rejected, 1);
+    shed_connection(worker, client_sockfd);
+    return 0;
   }
-  if (i == MAX_CONCURRENT_CONNS)
+  struct admission *admission = worker->config->admission;
+  Admission_verdict verdict = ADMIT_UNTRACKED;
+  if (admission != NULL)
+    verdict = admission_enter(admission, client_addr.sin_addr.s_addr, timer_now_ms());
+  if ((verdict == SHED_PER_IP) || (verdict == SHED_RATE))
   {
-    // send 503
-    printf("new connection, but too many existing -- sending 503\n");
-    char *msg;
-    size_t msg_len;
-    serialize_http_response(&msg, &msg_len, "503 Service Unavailable\n",
-                            NULL, NULL, NULL, 0, NULL);
-    int err = send(client_sockfd, msg, msg_len, MSG_NOSIGNAL);
-    ERR("could not send HTTP 503\n", err < 0)
+    LOG_DEBUG("worker %d: client over its %s limit, shedding fd %d", worker->id,
+              verdict == SHED_PER_IP ? "connection" : "rate", client_sockfd);
+    stats_add(&worker->stats->rejected, 1);
+    stats_add(verdict == SHED_PER_IP ? &worker->stats->shed_per_ip : &worker->stats->shed_rate,
+              1);
+    shed_connection(worker, client_sockfd);
     return 0;
   }
 
-  // new connection at location i in list
-  struct pollfd *client_pollfd = &(poll_list[i]);
-  client_pollfd->fd = client_sockfd;
-  client_pollfd->events = POLLIN;
-  client_pollfd->revents = 0;
-  struct client_info *client_info = &(client_info_list[i]);
+  struct client_info *client_info = calloc(1, sizeof(struct client_info));
+  if (client_info == NULL)
+  {
+    LOG_ERROR("out of memory for new connection");
+    if (verdict == ADMIT)
+      admission_leave(admission, client_addr.sin_addr.s_addr);
+    close(client_sockfd);
+    return 0;
+  }
+  client_info->worker = worker;
   client_info->addr = client_addr;
   client_info->addrlen = client_addrlen;
   client_info->connfd = client_sockfd;
+  client_info->admitted = verdict == ADMIT;
+  arena_init(&client_info->arena, ARENA_BLOCK_SIZE);
+
+  struct epoll_event ev;
+  ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+  ev.data.ptr = client_info;
+  if (epoll_ctl(worker->epfd, EPOLL_CTL_ADD, client_sockfd, &ev) < 0)
+  {
+    LOG_ERROR("couldn't register fd %d with epoll: %s", client_sockfd, strerror(errno));
+    if (client_info->admitted)
+      admission_leave(admission, client_addr.sin_addr.s_addr);
+    close(client_sockfd);
+    free(client_info);
+    return 0;
+  }
+  stats_add(&worker->stats->active, 1);
+  // the first request has as long as any other request's headers
+  client_deadline(client_info, DEADLINE_HEADER);
 
-  char *ip = inet_ntoa(client_addr.sin_addr);
-  printf("new connection successfully set up from %s fd %d at %d!\n", ip, client_sockfd, i);
+  if (LOG_ENABLED(LOG_LEVEL_DEBUG))
+  {
+    char ip[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &client_addr.sin_addr, ip, sizeof(ip));
+    LOG_DEBUG("worker %d: new connection from %s fd %d (%llu open)", worker->id, ip,
+              client_sockfd, (unsigned long long)worker->stats->active);
+  }
 
   return 1;
 }
 
-// struct {
-//   char *folder;
-// } server_info;
+void stream_end(struct client_info *client_info);
+void out_clear(struct out_queue *out);
 
-/* should be called when new data available in client-socket, returns if we
-  should keep the connection alive */
-int client_update(struct client_info *client_info, char *folder);
-inline int client_update(struct client_info *client_info, char *folder)
+/* closing the fd also drops it from the epoll set */
+void close_connection(struct client_info *client_info)
 {
-  int err;
-  char buf[BUF_SIZE];
-  int len = recv(client_info->connfd, buf, BUF_SIZE,
-                 MSG_DONTWAIT | MSG_PEEK);
-  if (len < 0)
+  if (client_info->stream != NULL)
+    stream_end(client_info);
+  out_clear(&client_info->out);
+  if (client_info->admitted)
+    admission_leave(client_info->worker->config->admission, client_info->addr.sin_addr.s_addr);
+  stats_add(&client_info->worker->stats->active, -1); // wraps around to one less
+  timer_cancel(&client_info->worker->timers, &client_info->timer);
+  close(client_info->connfd);
+  free(client_info->recv_buf);
+  arena_destroy(&client_info->arena);
+  free(client_info);
+}
+
+/* a connection's deadline passed. a client that stalled halfway through a
+  request is told so with a 408, an idle one is just closed */
+void connection_expired(struct timer *timer, void *arg)
+{
+  struct client_info *client_info =
+      (struct client_info *)((char *)timer - offsetof(struct client_info, timer));
+  stats_add(&client_info->worker->stats->timed_out, 1);
+  LOG_DEBUG("closing connection with fd %d, its deadline %d passed", client_info->connfd,
+            client_info->deadline);
+  if ((client_info->deadline == DEADLINE_HEADER) || (client_info->deadline == DEADLINE_BODY))
   {
-    printf("couldn't receive data from %d: %s\n", client_info->connfd,
-           strerror(errno));
-    return 1;
+    size_t msg_len;
+    const char *msg = error_response(HTTP_408, &msg_len);
+    send(client_info->connfd, msg, msg_len, MSG_DONTWAIT | MSG_NOSIGNAL);
   }
+  close_connection(client_info);
+}
 
-  if (len == 0)
+/* out_flush() return values */
+#define OUT_DONE 0    // the queue is empty
+#define OUT_BLOCKED 1 // the socket's send buffer is full
+#define OUT_FAILED 2  // sending failed, the connection is done for
+
+/* lets go of what an item holds */
+void out_release(struct out_item *item)
+{
+  if (item->close_fd)
+    close(item->fd);
+  free(item->owned);
+  if (item->ref != NULL)
+    cache_entry_release(item->ref);
+}
+
+/* drops everything queued without sending it */
+void out_clear(struct out_queue *out)
+{
+  for (size_t i = out->head; i < out->count; i++)
+    out_release(&out->items[i]);
+  free(out->items);
+  memset(out, 0, sizeof(*out));
+}
+
+/* drops the first n unsent bytes of the queue, which the socket took */
+void out_consume(struct out_queue *out, size_t n)
+{
+  out->bytes -= n;
+  while ((out->head < out->count) && (n >= out->items[out->head].len))
   {
-    return 0;
+    n -= out->items[out->head].len;
+    out_release(&out->items[out->head]);
+    out->head++;
   }
-
-  Request request;
-  int parse_err = parse_http_request(buf, len, &request);
-  if (parse_err == TEST_ERROR_PARSE_PARTIAL)
+  if (out->head == out->count)
   {
-    printf("parsing partial'ed %d bytes\n", len);
-    return 1;
+    out->head = 0;
+    out->count = 0;
   }
+  else if (n > 0)
+  {
+    struct out_item *item = &out->items[out->head];
+    if (item->buf != NULL)
+      item->buf += n;
+    else
+      item->offset += n;
+    item->len -= n;
+  }
+}
 
-  printf("version: [%s], method: [%s]\n", request.http_version, request.http_method);
-  int wrong_version = (strcmp(request.http_version, "HTTP/1.1") != 0);
-  int no_method = ((strcmp(request.http_method, "GET") != 0) && (strcmp(request.http_method, "HEAD") != 0) && (strcmp(request.http_method, "POST") != 0));
-  int is_req_invalid = (parse_err == TEST_ERROR_PARSE_FAILED) || wrong_version ||
-                       no_method;
-  if (is_req_invalid)
-  { // || wrong_version || no_method) {
-    printf("parsing failed, sending HTTP 400\n");
-    // send HTTP 400
-    char *msg;
-    size_t msg_len;
-    serialize_http_response(&msg, &msg_len, "400 Bad Request\n",
-                            NULL, NULL, NULL, 0, NULL);
-    err = send(client_info->connfd, msg, msg_len, MSG_NOSIGNAL);
-    if (err < 0)
+/* sends as much of the queue as the socket takes: runs of memory items go
+  out with one sendmsg() each, file ranges with sendfile(). never blocks. a
+  failed send fails the queue, what is pushed after it is dropped */
+int out_flush(struct client_info *client_info)
+{
+  struct out_queue *out = &client_info->out;
+  if (out->failed)
+    return OUT_FAILED;
+  while (out->head < out->count)
+  {
+    struct out_item *item = &out->items[out->head];
+    uint64_t start = stats_now();
+    ssize_t n;
+    if (item->buf == NULL)
+    {
+      off_t offset = item->offset;
+      n = sendfile(client_info->connfd, item->fd, &offset, item->len);
+      if (n == 0)
+      {
+        // the file shrank underneath us, the response can't be finished
+        LOG_WARN("could not send file: it shrank");
+        out->failed = true;
+        return OUT_FAILED;
+      }
+    }
+    else
+    {
+      // MSG_MORE when a file range or a streamed chunk follows right away
+      struct iovec iov[MAX_BATCH_IOV];
+      int n_iov = 0;
+      int flags = client_info->stream != NULL ? MSG_MORE : 0;
+      for (size_t i = out->head; (i < out->count) && (n_iov < MAX_BATCH_IOV); i++)
+      {
+        if (out->items[i].buf == NULL)
+        {
+          flags = MSG_MORE;
+          break;
+        }
+        iov[n_iov].iov_base = out->items[i].buf;
+        iov[n_iov].iov_len = out->items[i].len;
+        n_iov++;
+      }
+      // sendmsg() is writev() with flags, MSG_NOSIGNAL keeps a closed peer
+      // from raising SIGPIPE
+      struct msghdr msg;
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_iov = iov;
+      msg.msg_iovlen = n_iov;
+      n = sendmsg(client_info->connfd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL | flags);
+    }
+    if (n < 0)
     {
-      printf("could not send HTTP 400\n");
+      if (errno == EINTR)
+        continue;
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+        return OUT_BLOCKED;
+      LOG_WARN("could not send HTTP response: %s", strerror(errno));
+      out->failed = true;
+      return OUT_FAILED;
     }
+    stats_record(client_info->worker->stats, STATS_PHASE_SEND, start);
+    stats_add(&client_info->worker->stats->bytes_sent, n);
+    out_consume(out, n);
   }
-  size_t content_length = 0;
+  return OUT_DONE;
+}
+
+/* flushes between requests. once everything is sent the memory of the
+  requests that were answered goes back to the arena, unless a parked job or
+  a stream still uses it */
+int client_flush(struct client_info *client_info)
+{
+  int res = out_flush(client_info);
+  if ((res == OUT_DONE) && (client_info->stream == NULL) &&
+      (client_info->job.state == JOB_IDLE))
+    arena_reset(&client_info->arena);
+  return res;
+}
+
+/* whether the connection has too much output queued to take on another
+  request. past the high watermark it stops until the client has read down
+  to the low one. what the queue holds in the arena, copies of echoed
+  bodies, is counted in its bytes */
+bool client_backed_up(struct client_info *client_info)
+{
+  size_t limit = client_info->backed_up ? OUT_LOW_WATERMARK : OUT_HIGH_WATERMARK;
+  client_info->backed_up = client_info->out.bytes > limit;
+  return client_info->backed_up;
+}
 
-  for (int i = 0; i < request.header_count; i++)
+/* appends an item to the connection's queue. once OUTPUT_BUDGET bytes are
+  queued they are sent right away, unless the socket is known to be full.
+  the item's resources belong to the queue from here on, even when out of
+  memory, which fails the connection's output */
+void out_push(struct client_info *client_info, struct out_item *item)
+{
+  struct out_queue *out = &client_info->out;
+  if (out->failed)
+  {
+    out_release(item);
+    return;
+  }
+  if (out->count == out->cap)
   {
-    if ((strcasecmp(request.headers[i].header_name, "Content-Length") == 0) || (strcasecmp(request.headers[i].header_name, "content-length") == 0))
+    if (out->head > 0)
     {
-      content_length = atoi(request.headers[i].header_value);
-      printf("content length %d", content_length);
-      break;
+      // the sent items make room
+      memmove(out->items, out->items + out->head,
+              (out->count - out->head) * sizeof(struct out_item));
+      out->count -= out->head;
+      out->head = 0;
+    }
+    else
+    {
+      size_t cap = out->cap == 0 ? OUT_QUEUE_INIT : 2 * out->cap;
+      struct out_item *items = realloc(out->items, cap * sizeof(struct out_item));
+      if (items == NULL)
+      {
+        LOG_ERROR("out of memory for the output of fd %d", client_info->connfd);
+        out_release(item);
+        out->failed = true;
+        return;
+      }
+      out->items = items;
+      out->cap = cap;
     }
   }
-  // shift the socket recv buffer
-  // printf("content length %d\n", request.status_header_size + content_length);
-  // err = recv(client_info->connfd, buf, request.status_header_size + content_length,
-  //            MSG_DONTWAIT);
+  out->items[out->count++] = *item;
+  out->bytes += item->len;
+  client_info->queued += item->len;
+  if ((out->bytes >= OUTPUT_BUDGET) && !client_info->want_out)
+    out_flush(client_info);
+}
+
+/* queues a response for the connection. buf has to stay valid until it is
+  sent, the arena is only reset once the whole queue is */
+void out_add(struct client_info *client_info, char *buf, size_t len)
+{
+  if (len == 0)
+    return;
+  struct out_item item = {buf, len, -1, 0, false, NULL, NULL};
+  out_push(client_info, &item);
+}
+
+/* out_add() of a malloc()ed buf, which is freed once it is sent */
+void out_add_owned(struct client_info *client_info, char *buf, size_t len)
+{
+  struct out_item item = {buf, len, -1, 0, false, buf, NULL};
+  out_push(client_info, &item);
+}
+
+/* out_add() of a copy of buf in the arena, for memory that doesn't live
+  until it is sent. returns false, with nothing queued, when out of memory */
+bool out_add_copy(struct client_info *client_info, const char *buf, size_t len)
+{
+  char *copy = arena_alloc(&client_info->arena, len);
+  if (copy == NULL)
+    return false;
+  memcpy(copy, buf, len);
+  out_add(client_info, copy, len);
+  return true;
+}
 
-  err = recv(client_info->connfd, buf, request.status_header_size + content_length,
-             MSG_DONTWAIT);
-  if (err < 0)
+/* queues len bytes of fd starting at offset. the file data never passes
+  through user space */
+void out_add_range(struct client_info *client_info, int fd, off_t offset, size_t len)
+{
+  if (len == 0)
+    return;
+  struct out_item item = {NULL, len, fd, offset, false, NULL, NULL};
+  out_push(client_info, &item);
+}
+
+/* out_add_range(), and fd is closed once it is sent */
+void out_add_file(struct client_info *client_info, int fd, off_t offset, size_t len)
+{
+  struct out_item item = {NULL, len, fd, offset, true, NULL, NULL};
+  if (len == 0)
+    close(fd);
+  else
+    out_push(client_info, &item);
+}
+
+/* queues a cached response, with the current Date line swapped in. takes
+  over the caller's reference to entry */
+void out_add_cached(struct client_info *client_info, struct cache_entry *entry)
+{
+  // the reference goes with the last piece
+  struct out_item item = {entry->blob, entry->blob_len, -1, 0, false, NULL, entry};
+  if (entry->date_len > 0)
   {
-    printf("coulnd't shift buffer 2: %s\n", strerror(errno));
+    // the thread's date line is only ever rewritten in place
+    size_t date_len;
+    const char *date = http_date_line(&date_len);
+    size_t rest = entry->date_off + entry->date_len;
+    out_add(client_info, entry->blob, entry->date_off);
+    out_add(client_info, (char *)date, date_len);
+    item.buf = entry->blob + rest;
+    item.len = entry->blob_len - rest;
   }
+  out_push(client_info, &item);
+}
 
+/* keeps the request line of the request being answered in the arena, for
+  the access log */
+void keep_request_line(struct client_info *client_info, Request *request)
+{
+  client_info->request_line = NULL;
+  if (!log_access_enabled)
+    return;
+  size_t len = strlen(request->http_method) + strlen(request->http_uri) +
+               strlen(request->http_version) + 2;
+  char *line = arena_alloc(&client_info->arena, len + 1);
+  if (line == NULL)
+    return;
+  sprintf(line, "%s %s %s", request->http_method, request->http_uri, request->http_version);
+  client_info->request_line = line;
+  client_info->request_line_len = len;
+}
 
-  if (strcmp(request.http_method, "POST") == 0)
-  {
-      printf("about ot print buf%s\n");
-    printf("%s\n", buf);
-    err = send(client_info->connfd, buf, strlen(buf), MSG_NOSIGNAL);
-    if (err < 0)
-    {
-      printf("could not send HTTP response: %s\n", strerror(errno));
-    }
-  } else {
-  { 
+/* counts a response to the request being answered, once it is queued, and
+  logs it to the access log with its size as queued, headers included. a
+  stream is only counted once it has ended, so all of it is */
+void count_response(struct client_info *client_info, Http_status status)
+{
+  stats_count_response(client_info->worker->stats, client_info->method, status);
+  if (log_access_enabled)
+    log_access(client_info->addr.sin_addr.s_addr, client_info->request_line,
+               client_info->request_line_len, atoi(STATUS_LINES[status].str + 9),
+               client_info->queued - client_info->response_start);
+}
 
-    char buffer[BUF_SIZE];
-    size_t size = 0;
-    serialize_http_request(buffer, &size, &request);
-    buffer[size] = '\0';
-    printf("accsessed buf end\n");
-    printf("received HTTP request:\n%s, read in %d bytes\n", buffer, len);
-    printf("status_header_size is %d\n", request.status_header_size);
-    printf("buffer size is %d\n", size);
+/* answers the request being handled with the body-less response for an
+  error status */
+void respond_error(struct client_info *client_info, Http_status status)
+{
+  size_t msg_len;
+  const char *msg = error_response(status, &msg_len);
+  out_add(client_info, (char *)msg, msg_len);
+  count_response(client_info, status);
+}
+
+/* starts a streamed response with the given status line and headers. the
+  caller parks the connection; release(state) is called when the stream
+  ends, however it ends. returns false, with nothing sent and state left to
+  the caller, when out of memory */
+bool stream_start(struct client_info *client_info, Http_status status, const char *content_type,
+                  int flags, stream_produce_fn produce, void (*release)(void *), void *state)
+{
+  char *head = arena_alloc(&client_info->arena, RESPONSE_HEADER_MAX);
+  struct response_stream *stream = malloc(sizeof(struct response_stream));
+  if ((head == NULL) || (stream == NULL))
+  {
+    free(stream);
+    return false;
   }
+  stream->produce = produce;
+  stream->release = release;
+  stream->state = state;
+  stream->status = status;
+  stream->out = NULL;
+  stream->out_len = 0;
+  stream->done = false;
+  client_info->stream = stream;
+  size_t header_len = serialize_response_header(head, status, content_type, 0, NULL,
+                                                flags | RESPONSE_CHUNKED);
+  out_add(client_info, head, header_len);
+  return true;
+}
 
-  if (!is_req_invalid)
+/* stream_pump() return values */
+#define STREAM_DONE 0    // the whole body is sent
+#define STREAM_BLOCKED 1 // the socket's send buffer is full
+#define STREAM_FAILED 2  // producing or sending failed
+
+/* produces and sends chunks until the body is complete or the socket
+  pushes back */
+int stream_pump(struct client_info *client_info)
+{
+  struct response_stream *stream = client_info->stream;
+  // the headers, and whatever was queued before them, go out first
+  int res = out_flush(client_info);
+  if (res != OUT_DONE)
+    return res == OUT_BLOCKED ? STREAM_BLOCKED : STREAM_FAILED;
+  while (1)
   {
-    size_t resp_len;
-    char *resp = process_http_request(&request, &resp_len, folder);
-    err = send(client_info->connfd, resp, resp_len, MSG_NOSIGNAL);
-    if (err < 0)
+    if (stream->out_len == 0)
+    {
+      if (stream->done)
+        return STREAM_DONE;
+      char *data = stream->buf + CHUNK_HEADER_MAX;
+      ssize_t n = stream->produce(stream->state, data, STREAM_CHUNK_SIZE);
+      if (n < 0)
+        return STREAM_FAILED;
+      if (n == 0)
+      {
+        memcpy(data, LAST_CHUNK.str, LAST_CHUNK.len);
+        stream->out = data;
+        stream->out_len = LAST_CHUNK.len;
+        stream->done = true;
+      }
+      else
+      {
+        // the size line goes right in front of the data
+        char size_line[CHUNK_HEADER_MAX];
+        size_t size_len = serialize_chunk_header(size_line, n);
+        stream->out = data - size_len;
+        memcpy(stream->out, size_line, size_len);
+        memcpy(data + n, CRLF_TEMPLATE.str, CRLF_TEMPLATE.len);
+        stream->out_len = size_len + n + CRLF_TEMPLATE.len;
+      }
+    }
+    ssize_t n = send(client_info->connfd, stream->out, stream->out_len,
+                     MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (n < 0)
     {
-      printf("could not send HTTP response: %s\n", strerror(errno));
+      if (errno == EINTR)
+        continue;
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+        return STREAM_BLOCKED;
+      LOG_WARN("could not send streamed response: %s", strerror(errno));
+      return STREAM_FAILED;
     }
+    stats_add(&client_info->worker->stats->bytes_sent, n);
+    client_info->queued += n;
+    stream->out += n;
+    stream->out_len -= n;
   }
+}
 
-  }
-  // if((parse_err == TEST_ERROR_PARSE_FAILED) || wrong_version)
-  //   return 1;
-  // check for connection: close
-  int to_close = 0;
-  for (size_t h = 0; h < request.header_count; h++)
-  {
-    char *name = request.headers[h].header_name;
-    name[0] = tolower(name[0]);
-    // printf("header_name [%s]\n", request.headers[h].header_name);
-    if (strcmp(request.headers[h].header_name, "connection") != 0)
-      continue;
-    char *val = request.headers[h].header_value;
-    val[0] = tolower(val[0]);
-    // printf("header_value [%s]\n", val + strlen(val) - 5);
-    if ((strlen(val) >= 5) && (strcmp(val + strlen(val) - 5, "close") == 0))
-      to_close = 1;
-  }
-  if (to_close)
-  {
-    printf("got a connection close: closing connection with fd %d\n", client_info->connfd);
-    return 0;
-  }
+/* frees the connection's stream */
+void stream_end(struct client_info *client_info)
+{
+  struct response_stream *stream = client_info->stream;
+  stream->release(stream->state);
+  free(stream);
+  client_info->stream = NULL;
 }
 
-int main(int argc, char *argv[])
+/* turns a 200 response into a cache entry, reading the body in if it was
+  left for sendfile(). returns NULL, with the response left intact, if it
+  can't be cached */
+struct cache_entry *cache_response(struct file_cache *cache, char *key,
+                                   Response *response, time_t now)
 {
-  /* Validate and parse args */
-  if (argc != 2)
+  if ((cache == NULL) || (response->path == NULL))
+    return NULL;
+  size_t body_len = response->body_fd >= 0 ? response->body_len : 0;
+  size_t blob_len = response->header_len + body_len;
+  if (blob_len > cache->max_entry)
+    return NULL;
+
+  // the cache outlives the request, so the response is copied out of the
+  // arena
+  char *blob = malloc(blob_len);
+  if (blob == NULL)
+    return NULL;
+  memcpy(blob, response->header, response->header_len);
+  size_t done = 0;
+  while (done < body_len)
   {
-    fprintf(stderr, "usage: %s <www-folder>\n", argv[0]);
-    return EXIT_FAILURE;
+    ssize_t n = pread(response->body_fd, blob + response->header_len + done,
+                      body_len - done, response->body_offset + done);
+    if (n <= 0)
+    {
+      free(blob);
+      return NULL;
+    }
+    done += n;
   }
 
-  char *www_folder = argv[1];
-
-  DIR *www_dir = opendir(www_folder);
-  if (www_dir == NULL)
+  struct cache_entry *entry = file_cache_insert(cache, key, response->path,
+                                                &response->file_stat, blob, blob_len, now);
+  if (entry == NULL)
   {
-    fprintf(stderr, "Unable to open www folder %s.\n", www_folder);
-    return EXIT_FAILURE;
+    free(blob);
+    return NULL;
   }
+  if (response->body_fd >= 0)
+    close(response->body_fd);
+  response->header = NULL;
+  response->body_fd = -1;
+  return entry;
+}
 
-  closedir(www_dir);
-  printf("setting up socket.. \n");
-  /* CP1: Set up sockets and read the buf */
-  int err;
+/* starts reading the file a request names through the worker's ring.
+  returns false, with nothing started, if the ring is full */
+bool file_job_start(struct client_info *client_info, Request *request, char *folder)
+{
+  struct worker *worker = client_info->worker;
+  struct file_job *job = &client_info->job;
+  // leave bad URIs to process_http_request()
+  if (request->http_uri[0] != '/')
+    return false;
 
-  /* Set up socket, sockaddr_in, poll list */
-  int sockfd = socket(AF_INET, SOCK_STREAM, 0);
-  ERR("couldn't make server socket\n", (sockfd < 0));
-  int optval = 1;
-  setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
-  setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval));
-  /* tcp timeout */
-  optval = 3000;
-  setsockopt(sockfd, IPPROTO_TCP, TCP_USER_TIMEOUT, &optval, sizeof(optval));
+  // the connection is parked until the file is read, so what is queued
+  // goes out now as far as the socket takes it; the rest waits for the job
+  out_flush(client_info);
+  size_t path_len = strlen(folder) + strlen(request->http_uri);
+  job->path = arena_alloc(&client_info->arena, path_len + strlen(INDEX_FILE) + 1);
+  job->key = arena_strdup(&client_info->arena, request->http_uri);
+  if ((job->path == NULL) || (job->key == NULL))
+    return false;
+  strcpy(job->path, folder);
+  strcat(job->path, request->http_uri);
 
-  struct sockaddr_in sin;
-  bzero((char *)&sin, sizeof(sin));
-  sin.sin_family = AF_INET;
-  sin.sin_addr.s_addr = INADDR_ANY;
-  sin.sin_port = htons(HTTP_PORT);
+  if (!uring_openat(worker->ring, job->path, O_RDONLY | O_CLOEXEC, client_info))
+    return false;
+  uring_submit(worker->ring);
+  job->state = JOB_OPEN;
+  job->dir_retry = false;
+  job->fd = -1;
+  job->buf = NULL;
+  job->cacheable = false;
+  job->started = stats_now();
+  return true;
+}
 
-  err = bind(sockfd, (struct sockaddr *)&sin, sizeof(sin));
-  ERR("couldn't bind\n", (err < 0));
-  listen(sockfd, 100000);
+/* ends the job with an error response */
+void file_job_fail(struct client_info *client_info, Http_status status)
+{
+  struct file_job *job = &client_info->job;
+  if (job->fd >= 0)
+    close(job->fd);
+  if (job->cacheable)
+    free(job->buf);
+  job->fd = -1;
+  job->buf = NULL;
+  job->state = JOB_IDLE;
+  stats_record(client_info->worker->stats, STATS_PHASE_FILE_IO, job->started);
+  respond_error(client_info, status);
+}
 
-  // validity in the lists is based on whether the corresponding entry in
-  //  poll_list has pollfd != -1
-  struct pollfd poll_list[MAX_CONCURRENT_CONNS + 1]; // extra is for server
-  for (size_t i = 0; i < MAX_CONCURRENT_CONNS; i++)
+/* queues the read of the rest of the file. returns true if it went through
+  the ring, otherwise it was done synchronously and *res is its result */
+bool file_job_read(struct worker *worker, struct client_info *client_info, int *res)
+{
+  struct file_job *job = &client_info->job;
+  size_t header_len = job->len - job->stx.stx_size;
+  char *dst = job->buf + job->done;
+  size_t want = job->len - job->done;
+  off_t offset = job->done - header_len;
+  if (uring_read(worker->ring, job->fd, dst, want, offset, client_info))
   {
-    poll_list[i].fd = -1;
-    poll_list[i].events = POLLIN | POLLHUP | POLLERR;
-    poll_list[i].revents = 0;
+    uring_submit(worker->ring);
+    return true;
   }
-  struct client_info client_info_list[MAX_CONCURRENT_CONNS];
+  ssize_t n = pread(job->fd, dst, want, offset);
+  *res = n < 0 ? -errno : n;
+  return false;
+}
 
-  struct pollfd *my_pollfd = &(poll_list[MAX_CONCURRENT_CONNS]);
-  my_pollfd->fd = sockfd;
-  my_pollfd->events = POLLIN;
-  my_pollfd->revents = 0;
+/* the parts of a statx() the cache and the validators look at */
+void statx_to_stat(const struct statx *stx, struct stat *st)
+{
+  memset(st, 0, sizeof(*st));
+  st->st_mode = stx->stx_mode;
+  st->st_size = stx->stx_size;
+  st->st_ino = stx->stx_ino;
+  st->st_mtim.tv_sec = stx->stx_mtime.tv_sec;
+  st->st_mtim.tv_nsec = stx->stx_mtime.tv_nsec;
+}
 
-  while (1)
+/* the file is read in: cache it and queue the response */
+void file_job_finish(struct client_info *client_info)
+{
+  struct worker *worker = client_info->worker;
+  struct file_job *job = &client_info->job;
+  close(job->fd);
+  job->fd = -1;
+  job->state = JOB_IDLE;
+  stats_record(worker->stats, STATS_PHASE_FILE_IO, job->started);
+  struct cache_entry *entry = NULL;
+  if (job->cacheable)
   {
-    /* check for new connections */
-    int n_ready = poll(poll_list, MAX_CONCURRENT_CONNS + 1, DEFAULT_TIMEOUT);
-    if (n_ready == 0)
-    {
-      // printf("nothing so far!\n");
-      printf("nothing so far %d\n", poll_list[0].fd);
-    }
+    struct stat st;
+    statx_to_stat(&job->stx, &st);
+    entry = file_cache_insert(worker->cache, job->key, job->path, &st, job->buf, job->len,
+                              time(NULL));
+  }
+  // a buffer the cache didn't take is freed once it is sent
+  if (entry != NULL)
+    out_add_cached(client_info, entry);
+  else if (job->cacheable)
+    out_add_owned(client_info, job->buf, job->len);
+  else
+    out_add(client_info, job->buf, job->len);
+  job->buf = NULL;
+  count_response(client_info, HTTP_200);
+}
 
-    if (my_pollfd->revents & POLLIN)
+/* advances the job by the result of its last operation. a step the ring has
+  no room for is done synchronously, so a job always makes progress */
+void file_job_step(struct worker *worker, struct client_info *client_info, int res)
+{
+  struct file_job *job = &client_info->job;
+  while (1)
+  {
+    switch (job->state)
     {
-      n_ready--;
-      // I'm hoping poll() will reset this if there are multiple connections
-      // pending
-      my_pollfd->revents = 0;
+    case JOB_OPEN:
+      if (res < 0)
+      {
+        file_job_fail(client_info, (res == -ENOENT) || (res == -ENOTDIR) ? HTTP_404 : HTTP_500);
+        return;
+      }
+      job->fd = res;
+      job->state = JOB_STAT;
+      if (uring_statx(worker->ring, job->fd, &job->stx, client_info))
+      {
+        uring_submit(worker->ring);
+        return;
+      }
+      res = statx(job->fd, "", AT_EMPTY_PATH, STATX_BASIC_STATS, &job->stx) < 0 ? -errno : 0;
+      break;
 
-      new_connection(sockfd, poll_list, client_info_list);
-      if (n_ready == 0)
-        continue;
-    }
-    else if (my_pollfd->revents != 0)
-    {
-      printf("weird server socket file state\n");
-    }
-    printf("%d events!\n", n_ready);
+    case JOB_STAT:
+      if (res < 0)
+      {
+        file_job_fail(client_info, HTTP_500);
+        return;
+      }
+      if (S_ISDIR(job->stx.stx_mode) && !job->dir_retry)
+      {
+        close(job->fd);
+        job->fd = -1;
+        strcat(job->path, INDEX_FILE);
+        job->dir_retry = true;
+        job->state = JOB_OPEN;
+        if (uring_openat(worker->ring, job->path, O_RDONLY | O_CLOEXEC, client_info))
+        {
+          uring_submit(worker->ring);
+          return;
+        }
+        res = open(job->path, O_RDONLY | O_CLOEXEC);
+        if (res < 0)
+          res = -errno;
+        break;
+      }
+      if (!S_ISREG(job->stx.stx_mode))
+      {
+        file_job_fail(client_info, HTTP_500);
+        return;
+      }
 
-    for (int i = 0; i < MAX_CONCURRENT_CONNS; i++)
-    {
-      struct pollfd *pollfd = &(poll_list[i]);
-      if (pollfd->fd < 0)
-        continue;
-      int revents = pollfd->revents;
-      pollfd->revents = 0;
-      printf("connfd is %d, revents is %d\n", pollfd->fd, revents);
-      char c;
-      if ((revents & POLLHUP) && (recv(pollfd->fd, &c, 1, MSG_DONTWAIT | MSG_PEEK) == 0))
+      size_t size = job->stx.stx_size;
+      struct stat st;
+      statx_to_stat(&job->stx, &st);
+      size_t header_len = serialize_file_header(job->head, HTTP_200, NULL, size, &st,
+                                                is_compressible(job->path) ? RESPONSE_VARY : 0);
+      job->len = header_len + size;
+      job->cacheable = (worker->cache != NULL) && (job->len <= worker->cache->max_entry);
+      if (!job->cacheable && (size >= SENDFILE_MIN_SIZE))
       {
-        printf("2 closing connection  with fd %d\n", pollfd->fd);
-        close(pollfd->fd);
-        pollfd->fd = -1;
-        continue;
+        // never read through user space at all. the next job reuses
+        // job->head while this one may still be queued
+        if (!out_add_copy(client_info, job->head, header_len))
+        {
+          file_job_fail(client_info, HTTP_500);
+          return;
+        }
+        out_add_file(client_info, job->fd, 0, size);
+        job->fd = -1;
+        job->state = JOB_IDLE;
+        stats_record(worker->stats, STATS_PHASE_FILE_IO, job->started);
+        count_response(client_info, HTTP_200);
+        return;
       }
-      if ((revents & POLLIN) == 0)
-        continue;
+      job->buf = job->cacheable ? malloc(job->len) : arena_alloc(&client_info->arena, job->len);
+      if (job->buf == NULL)
+      {
+        job->cacheable = false;
+        file_job_fail(client_info, HTTP_500);
+        return;
+      }
+      memcpy(job->buf, job->head, header_len);
+      job->done = header_len;
+      job->state = JOB_READ;
+      if (job->done == job->len)
+      {
+        file_job_finish(client_info);
+        return;
+      }
+      if (file_job_read(worker, client_info, &res))
+        return;
+      break;
 
-      printf("REVENTS %d\n", revents);
-      struct client_info *client_info = &(client_info_list[i]);
-      int keep = client_update(client_info, www_folder);
-      if (!keep)
+    case JOB_READ:
+      if (res <= 0)
       {
-        printf("3 closing connection  with fd %d\n", client_info->connfd);
-        close(pollfd->fd);
-        pollfd->fd = -1;
-        continue;
+        // an error, or the file shrank underneath us
+        file_job_fail(client_info, HTTP_500);
+        return;
+      }
+      job->done += res;
+      if (job->done == job->len)
+      {
+        file_job_finish(client_info);
+        return;
       }
+      if (file_job_read(worker, client_info, &res))
+        return;
+      break;
+
+    case JOB_IDLE:
+      return;
     }
   }
 }
+
+/* reads len bytes from the start of fd. returns false if it fails or the
+  file is shorter */
+bool read_file(int fd, char *buf, size_t len)
+{
+  size_t done = 0;
+  while (done < len)
+  {
+    ssize_t n = pread(fd, buf + done, len - done, done);
+    if (n <= 0)
+      return false;
+    done += n;
+  }
+  return true;
+}
+
+/* If-Range names the version of the file the client has ranges of. they are
+  only sent if the file still is that version */
+bool if_range_matches(Request *request, const struct stat *st)
+{
+  size_t len;
+  const char *v = request_header(request, HEADER_IF_RANGE, &len);
+  if (v == NULL)
+    return true;
+  // an ETag, compared strongly, or the Last-Modified date
+  char validator[ETAG_MAX];
+  size_t validator_len;
+  if (v[0] == '"')
+    validator_len = format_etag(validator, st, false);
+  else
+    validator_len = format_http_date(validator, sizeof(validator), st->st_mtime);
+  return (len == validator_len) && (memcmp(v, validator, len) == 0);
+}
+
+/* answers a GET with a Range header: 206 with the range, multipart/byteranges
+  if there are several and 416 if none of them overlaps the file. the ranges
+  are sent straight from the file. returns false, with nothing sent, if the
+  whole file should go out instead */
+bool respond_range(struct client_info *client_info, Request *request, char *folder)
+{
+  static __thread unsigned long boundary_seq;
+  struct arena *arena = &client_info->arena;
+  if (request->http_uri[0] != '/')
+    return false;
+  size_t path_len = strlen(folder) + strlen(request->http_uri);
+  char *path = arena_alloc(arena, path_len + strlen(INDEX_FILE) + 1);
+  char *head = arena_alloc(arena, RESPONSE_HEADER_MAX);
+  if ((path == NULL) || (head == NULL))
+    return false;
+  strcpy(path, folder);
+  strcat(path, request->http_uri);
+  struct stat st;
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if ((fd >= 0) && (fstat(fd, &st) == 0) && S_ISDIR(st.st_mode))
+  {
+    close(fd);
+    strcat(path, INDEX_FILE);
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+  }
+  // errors are left to the regular path
+  if (fd < 0)
+    return false;
+  if ((fstat(fd, &st) != 0) || !S_ISREG(st.st_mode))
+  {
+    close(fd);
+    return false;
+  }
+
+  Http_range ranges[MAX_RANGES];
+  int count;
+  Range_result result = request_ranges(request, st.st_size, ranges, &count);
+  if ((result == RANGE_NONE) || !if_range_matches(request, &st))
+  {
+    close(fd);
+    return false;
+  }
+
+  int flags = is_compressible(path) ? RESPONSE_VARY : 0;
+  size_t header_len;
+  if (result == RANGE_UNSATISFIABLE)
+  {
+    close(fd);
+    header_len = serialize_response_header(head, HTTP_416, NULL, 0, NULL, flags);
+    header_len = response_add_header(head, header_len, "Content-Range: bytes */%lld",
+                                     (long long)st.st_size);
+    if (header_len == 0)
+    {
+      respond_error(client_info, HTTP_500);
+      return true;
+    }
+    out_add(client_info, head, header_len);
+    count_response(client_info, HTTP_416);
+    return true;
+  }
+  if (count == 1)
+  {
+    header_len = serialize_file_header(head, HTTP_206, NULL, ranges[0].len, &st, flags);
+    header_len = response_add_header(head, header_len, "Content-Range: bytes %lld-%lld/%lld",
+                                     (long long)ranges[0].start,
+                                     (long long)(ranges[0].start + ranges[0].len - 1),
+                                     (long long)st.st_size);
+    if (header_len == 0)
+    {
+      close(fd);
+      respond_error(client_info, HTTP_500);
+      return true;
+    }
+    out_add(client_info, head, header_len);
+    out_add_file(client_info, fd, ranges[0].start, ranges[0].len);
+    count_response(client_info, HTTP_206);
+    return true;
+  }
+
+  // every part gets a header of its own, Content-Length counts them all
+  char boundary[48];
+  snprintf(boundary, sizeof(boundary), "cmu_http_%lx_%lx", (unsigned long)st.st_ino,
+           ++boundary_seq);
+  char *parts[MAX_RANGES];
+  size_t part_len[MAX_RANGES];
+  size_t body_len = 0;
+  for (int i = 0; i < count; i++)
+  {
+    parts[i] = arena_alloc(arena, RANGE_PART_HEADER_MAX);
+    if (parts[i] == NULL)
+    {
+      close(fd);
+      return false;
+    }
+    part_len[i] = snprintf(parts[i], RANGE_PART_HEADER_MAX,
+                           "\r\n--%s\r\nContent-Range: bytes %lld-%lld/%lld\r\n\r\n", boundary,
+                           (long long)ranges[i].start,
+                           (long long)(ranges[i].start + ranges[i].len - 1),
+                           (long long)st.st_size);
+    body_len += part_len[i] + ranges[i].len;
+  }
+  char *trailer = arena_alloc(arena, RANGE_PART_HEADER_MAX);
+  if (trailer == NULL)
+  {
+    close(fd);
+    return false;
+  }
+  size_t trailer_len = snprintf(trailer, RANGE_PART_HEADER_MAX, "\r\n--%s--\r\n", boundary);
+  body_len += trailer_len;
+
+  char content_type[96];
+  snprintf(content_type, sizeof(content_type), "multipart/byteranges; boundary=%s", boundary);
+  header_len = serialize_file_header(head, HTTP_206, content_type, body_len, &st, flags);
+  if (header_len == 0)
+  {
+    close(fd);
+    respond_error(client_info, HTTP_500);
+    return true;
+  }
+  out_add(client_info, head, header_len);
+  for (int i = 0; i < count; i++)
+  {
+    out_add(client_info, parts[i], part_len[i]);
+    // the last range closes fd once it is sent
+    if (i == count - 1)
+      out_add_file(client_info, fd, ranges[i].start, ranges[i].len);
+    else
+      out_add_range(client_info, fd, ranges[i].start, ranges[i].len);
+  }
+  out_add(client_info, trailer, trailer_len);
+  count_response(client_info, HTTP_206);
+  return true;
+}
+
+/* the key the gzip variant of a URI is cached under */
+char *gzip_key(struct arena *arena, const char *uri)
+{
+  char *key = arena_alloc(arena, strlen(uri) + sizeof(GZIP_KEY_SUFFIX));
+  if (key == NULL)
+    return NULL;
+  strcpy(key, uri);
+  strcat(key, GZIP_KEY_SUFFIX);
+  return key;
+}
+
+/* the file process_http_request() would serve for uri, in the arena with
+  extra bytes to spare. returns NULL if it isn't a regular file */
+char *static_path(struct arena *arena, const char *folder, const char *uri, size_t extra,
+                  struct stat *st)
+{
+  if (uri[0] != '/')
+    return NULL;
+  char *path = arena_alloc(arena, strlen(folder) + strlen(uri) + strlen(INDEX_FILE) + extra + 1);
+  if (path == NULL)
+    return NULL;
+  strcpy(path, folder);
+  strcat(path, uri);
+  if (stat(path, st) != 0)
+    return NULL;
+  if (S_ISDIR(st->st_mode))
+  {
+    strcat(path, INDEX_FILE);
+    if (stat(path, st) != 0)
+      return NULL;
+  }
+  return S_ISREG(st->st_mode) ? path : NULL;
+}
+
+/* answers a conditional GET with 304 Not Modified if the client's copy is
+  still current. a cached response carries its ETag and the file's
+  modification time, so then there is no system call at all, otherwise the
+  file is only stat()ed. returns false, with nothing sent, if the full
+  response has to go out */
+bool respond_not_modified(struct client_info *client_info, Request *request, char *folder,
+                          bool has_variant, bool gzip, time_t now)
+{
+  struct worker *worker = client_info->worker;
+  struct arena *arena = &client_info->arena;
+  size_t inm_len, ims_len;
+  bool has_inm = request_header(request, HEADER_IF_NONE_MATCH, &inm_len) != NULL;
+  const char *ims = request_header(request, HEADER_IF_MODIFIED_SINCE, &ims_len);
+
+  // validators of the response the client would get; without a cached
+  // one, a gzip client may hold either variant
+  char tags[2][ETAG_MAX];
+  size_t tag_len[2];
+  int n_tags;
+  struct timespec mtime;
+  struct cache_entry *entry = NULL;
+  if ((worker->cache != NULL) && gzip)
+  {
+    char *key = gzip_key(arena, request->http_uri);
+    if (key != NULL)
+      entry = file_cache_lookup(worker->cache, key, now);
+  }
+  if ((worker->cache != NULL) && (entry == NULL))
+    entry = file_cache_lookup(worker->cache, request->http_uri, now);
+  if (entry != NULL)
+  {
+    bool usable = (entry->etag_len > 0) && (entry->etag_len < ETAG_MAX);
+    if (usable)
+    {
+      memcpy(tags[0], entry->blob + entry->etag_off, entry->etag_len);
+      tag_len[0] = entry->etag_len;
+      mtime = entry->mtime;
+    }
+    cache_entry_release(entry);
+    if (!usable)
+      return false;
+    n_tags = 1;
+  }
+  else
+  {
+    struct stat st;
+    if (static_path(arena, folder, request->http_uri, 0, &st) == NULL)
+      return false;
+    tag_len[0] = format_etag(tags[0], &st, false);
+    tag_len[1] = format_etag(tags[1], &st, true);
+    n_tags = gzip ? 2 : 1;
+    mtime = st.st_mtim;
+  }
+
+  // If-Modified-Since only counts without If-None-Match
+  int match = -1;
+  if (has_inm)
+  {
+    for (int i = 0; (i < n_tags) && (match < 0); i++)
+      if (request_etag_matches(request, tags[i], tag_len[i]))
+        match = i;
+  }
+  else
+  {
+    time_t since;
+    if (parse_http_date(ims, ims_len, &since) && (mtime.tv_sec <= since))
+      match = n_tags - 1;
+  }
+  if (match < 0)
+    return false;
+
+  char *head = arena_alloc(arena, RESPONSE_HEADER_MAX);
+  if (head == NULL)
+    return false;
+  char last_modified[64];
+  format_http_date(last_modified, sizeof(last_modified), mtime.tv_sec);
+  size_t header_len = serialize_response_header(head, HTTP_304, NULL, 0, last_modified,
+                                                has_variant ? RESPONSE_VARY : 0);
+  header_len = response_add_header(head, header_len, "ETag: %.*s", (int)tag_len[match],
+                                   tags[match]);
+  if (header_len == 0)
+  {
+    respond_error(client_info, HTTP_500);
+    return true;
+  }
+  out_add(client_info, head, header_len);
+  count_response(client_info, HTTP_304);
+  return true;
+}
+
+/* answers a client that accepts gzip with the compressed variant of a text
+  file: its precompressed .gz sibling if there is one, otherwise the file
+  compressed here. the variant is cached under a key of its own, and a file
+  is only compressed here if its variant is sure to fit in the cache, so it
+  is compressed once. returns false, with nothing sent, if there is no
+  variant and the identity response should go out */
+bool respond_gzip(struct client_info *client_info, Request *request, char *folder, time_t now)
+{
+  struct worker *worker = client_info->worker;
+  struct arena *arena = &client_info->arena;
+  char *key = gzip_key(arena, request->http_uri);
+  if (key == NULL)
+    return false;
+  struct cache_entry *entry = NULL;
+  if (worker->cache != NULL)
+    entry = file_cache_lookup(worker->cache, key, now);
+  if (entry != NULL)
+  {
+    out_add_cached(client_info, entry);
+    return true;
+  }
+
+  struct stat st;
+  char *path = static_path(arena, folder, request->http_uri, sizeof(".gz"), &st);
+  if ((path == NULL) || !is_compressible(path))
+    return false;
+
+  char head[RESPONSE_HEADER_MAX];
+  size_t header_len;
+  char *blob;
+  size_t blob_len;
+  size_t path_len = strlen(path);
+  strcpy(path + path_len, ".gz");
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if ((fd >= 0) && (fstat(fd, &st) == 0) && S_ISREG(st.st_mode))
+  {
+    // a precompressed sibling goes out as is, and the cache checks it for
+    // changes rather than the original
+    header_len = serialize_file_header(head, HTTP_200, NULL, st.st_size, &st,
+                                       RESPONSE_GZIP | RESPONSE_VARY);
+    blob_len = header_len + st.st_size;
+    if ((worker->cache == NULL) || (blob_len > worker->cache->max_entry))
+    {
+      char *header = arena_alloc(arena, header_len);
+      if (header == NULL)
+      {
+        close(fd);
+        return false;
+      }
+      memcpy(header, head, header_len);
+      out_add(client_info, header, header_len);
+      out_add_file(client_info, fd, 0, st.st_size);
+      return true;
+    }
+    blob = malloc(blob_len);
+    if ((blob == NULL) || !read_file(fd, blob + header_len, st.st_size))
+    {
+      free(blob);
+      close(fd);
+      return false;
+    }
+    close(fd);
+    memcpy(blob, head, header_len);
+  }
+  else
+  {
+    if (fd >= 0)
+      close(fd);
+    path[path_len] = '\0';
+    // compressing on every request costs more than sending the file as is
+    if (worker->cache == NULL)
+      return false;
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      return false;
+    // the variant is never bigger than the file, compression that doesn't
+    // pay is given up on below
+    char *data = NULL;
+    if ((fstat(fd, &st) == 0) && S_ISREG(st.st_mode) && (st.st_size <= GZIP_MAX_SIZE) &&
+        file_cache_fits(worker->cache, key, path, RESPONSE_HEADER_MAX + st.st_size))
+      data = malloc(st.st_size + 1);
+    if ((data == NULL) || !read_file(fd, data, st.st_size))
+    {
+      free(data);
+      close(fd);
+      return false;
+    }
+    close(fd);
+
+    // the body is compressed behind room for the headers, which are only
+    // known once its length is
+    size_t body_len;
+    blob = gzip_compress(data, st.st_size, RESPONSE_HEADER_MAX, &body_len);
+    if (blob == NULL)
+    {
+      free(data);
+      return false;
+    }
+    int flags = RESPONSE_GZIP | RESPONSE_VARY;
+    if (body_len >= (size_t)st.st_size)
+    {
+      // not worth it. gzip clients get the file as is, but it is cached
+      // under their key all the same so it isn't compressed again. the
+      // output buffer is never smaller than the input
+      memcpy(blob + RESPONSE_HEADER_MAX, data, st.st_size);
+      body_len = st.st_size;
+      flags = RESPONSE_VARY;
+    }
+    header_len = serialize_file_header(head, HTTP_200, NULL, body_len, &st, flags);
+    memcpy(blob, head, header_len);
+    memmove(blob + header_len, blob + RESPONSE_HEADER_MAX, body_len);
+    blob_len = header_len + body_len;
+    free(data);
+  }
+
+  if (worker->cache != NULL)
+    entry = file_cache_insert(worker->cache, key, path, &st, blob, blob_len, now);
+  if (entry != NULL)
+  {
+    out_add_cached(client_info, entry);
+    return true;
+  }
+  // a precompressed sibling too big to cache, or out of memory
+  out_add_owned(client_info, blob, blob_len);
+  return true;
+}
+
+/* streams an index of a directory that has no index file. returns false,
+  with nothing sent, if the URI names anything else */
+bool respond_listing(struct client_info *client_info, Request *request, char *folder)
+{
+  struct stat st;
+  size_t path_len = strlen(folder) + strlen(request->http_uri);
+  char *path = arena_alloc(&client_info->arena, path_len + strlen(INDEX_FILE) + 1);
+  if (path == NULL)
+    return false;
+  strcpy(path, folder);
+  strcat(path, request->http_uri);
+  if ((stat(path, &st) != 0) || !S_ISDIR(st.st_mode))
+    return false;
+  strcat(path, INDEX_FILE);
+  if (stat(path, &st) == 0)
+    return false;
+  path[path_len] = '\0';
+
+  struct dir_listing *listing = dir_listing_open(path, request->http_uri);
+  if (listing == NULL)
+    return false;
+  if (!stream_start(client_info, HTTP_200, "text/html", 0, dir_listing_read, dir_listing_close,
+                    listing))
+  {
+    dir_listing_close(listing);
+    return false;
+  }
+  return true;
+}
+
+/* the worker's room to aggregate the stats in, made the first time they
+  are asked for. NULL when out of memory */
+struct stats_scratch *worker_stats_scratch(struct worker *worker)
+{
+  if (worker->stats_scratch == NULL)
+  {
+    struct stats_scratch *scratch = malloc(sizeof(struct stats_scratch));
+    if ((scratch == NULL) || !stats_scratch_init(scratch))
+    {
+      free(scratch);
+      return NULL;
+    }
+    worker->stats_scratch = scratch;
+  }
+  return worker->stats_scratch;
+}
+
+/* answers STATS_URI with the counters of all workers. the JSON is copied
+  out of the scratch, a pipelined request for it may overwrite it before
+  it is sent */
+void respond_stats(struct client_info *client_info)
+{
+  const struct server_config *config = client_info->worker->config;
+  struct stats_scratch *scratch = worker_stats_scratch(client_info->worker);
+  size_t body_len = 0;
+  if (scratch != NULL)
+    body_len = stats_format(config->stats, config->n_workers, scratch);
+  char *head = NULL;
+  if (body_len > 0)
+    head = arena_alloc(&client_info->arena, RESPONSE_HEADER_MAX + body_len);
+  size_t header_len = 0;
+  if (head != NULL)
+  {
+    memcpy(head + RESPONSE_HEADER_MAX, scratch->json, body_len);
+    header_len = serialize_response_header(head, HTTP_200, "application/json", body_len, NULL,
+                                           0);
+    header_len = response_add_header(head, header_len, "Cache-Control: no-store");
+  }
+  if (header_len == 0)
+  {
+    respond_error(client_info, HTTP_500);
+    return;
+  }
+  out_add(client_info, head, header_len);
+  out_add(client_info, head + RESPONSE_HEADER_MAX, body_len);
+  count_response(client_info, HTTP_200);
+}
+
+/* answers a request for a static file, from the worker's cache if possible.
+  returns true if the connection was parked on a file read instead */
+bool respond_static(struct client_info *client_info, Request *request, char *folder)
+{
+  struct worker *worker = client_info->worker;
+  time_t now = time(NULL);
+  // text files, and directories for their index, may have a gzip variant
+  size_t uri_len = strlen(request->http_uri);
+  bool has_variant = (uri_len > 0) && ((request->http_uri[uri_len - 1] == '/') ||
+                                       is_compressible(request->http_uri));
+  bool gzip = has_variant && request_accepts_encoding(request, "gzip");
+
+  size_t len;
+  if (((request_header(request, HEADER_IF_NONE_MATCH, &len) != NULL) ||
+       (request_header(request, HEADER_IF_MODIFIED_SINCE, &len) != NULL)) &&
+      respond_not_modified(client_info, request, folder, has_variant, gzip, now))
+    return false;
+
+  // ranges are always sent from the file itself
+  if ((request_header(request, HEADER_RANGE, &len) != NULL) &&
+      (strcmp(request->http_method, "GET") == 0) && respond_range(client_info, request, folder))
+    return false;
+
+  // only 200 responses are cached
+  if (gzip && respond_gzip(client_info, request, folder, now))
+  {
+    count_response(client_info, HTTP_200);
+    return false;
+  }
+
+  struct cache_entry *entry = NULL;
+  if (worker->cache != NULL)
+    entry = file_cache_lookup(worker->cache, request->http_uri, now);
+  if (entry != NULL)
+  {
+    out_add_cached(client_info, entry);
+    count_response(client_info, HTTP_200);
+    return false;
+  }
+  // directories without an index file are listed while they are read
+  if (worker->config->autoindex && (uri_len > 0) && (request->http_uri[uri_len - 1] == '/') &&
+      respond_listing(client_info, request, folder))
+    return true;
+  if ((worker->ring != NULL) && file_job_start(client_info, request, folder))
+    return true;
+
+  Response response;
+  process_http_request(request, &response, folder, &client_info->arena);
+  count_response(client_info, response.status);
+  entry = cache_response(worker->cache, request->http_uri, &response, now);
+  if (entry != NULL)
+  {
+    out_add_cached(client_info, entry);
+    return false;
+  }
+  // response.head goes out of scope before it is sent
+  if (response.header != response.head)
+    out_add(client_info, response.header, response.header_len);
+  else if (!out_add_copy(client_info, response.header, response.header_len))
+  {
+    close(response.body_fd);
+    client_info->out.failed = true;
+    return false;
+  }
+  if (response.body_fd >= 0)
+    out_add_file(client_info, response.body_fd, response.body_offset,
+                    response.body_len);
+  return false;
+}
+
+/* reads whatever the socket has into the connection's receive buffer,
+  growing it as needed. returns the number of bytes read, 0 if the peer
+  closed, -1 if there is nothing to read right now and -2 on errors */
+int recv_more(struct client_info *client_info)
+{
+  // drop the bytes of requests that were already handled
+  if (client_info->recv_start > 0)
+  {
+    memmove(client_info->recv_buf, client_info->recv_buf + client_info->recv_start,
+            client_info->recv_len - client_info->recv_start);
+    client_info->recv_len -= client_info->recv_start;
+    client_info->recv_start = 0;
+  }
+  if (client_info->recv_len == client_info->recv_cap)
+  {
+    size_t new_cap = client_info->recv_cap == 0 ? RECV_BUF_INIT : 2 * client_info->recv_cap;
+    if (new_cap > MAX_RECV_BUF)
+      return -2;
+    char *new_buf = realloc(client_info->recv_buf, new_cap);
+    if (new_buf == NULL)
+      return -2;
+    client_info->recv_buf = new_buf;
+    client_info->recv_cap = new_cap;
+  }
+  int len = recv(client_info->connfd, client_info->recv_buf + client_info->recv_len,
+                 client_info->recv_cap - client_info->recv_len, MSG_DONTWAIT);
+  if (len < 0)
+  {
+    if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+      return -1;
+    LOG_WARN("couldn't receive data from %d: %s", client_info->connfd, strerror(errno));
+    return -2;
+  }
+  client_info->recv_len += len;
+  return len;
+}
+
+/* should be called when new data available in client-socket. returns
+  CLIENT_CLOSE if the connection should be closed, CLIENT_KEEP if we have to
+  wait for more data, CLIENT_PROGRESS if a request was consumed and
+  CLIENT_BLOCKED if the client has to read its responses first */
+int client_update(struct client_info *client_info, char *folder);
+inline int client_update(struct client_info *client_info, char *folder)
+{
+  struct worker_stats *stats = client_info->worker->stats;
+  Request request;
+  int parse_err;
+  bool parked = false;
+  // a connection whose output is backed up takes no new requests, they
+  // stay in recv_buf and the socket until the client reads
+  if (client_backed_up(client_info))
+  {
+    if (client_flush(client_info) == OUT_FAILED)
+      return CLIENT_CLOSE;
+    if (client_backed_up(client_info))
+      return CLIENT_BLOCKED;
+  }
+  // parse what is buffered first and only touch the socket when that is not
+  // a complete request; the CRLFCRLF scan picks up where it stopped. the
+  // responses to everything parsed so far start going out before reading.
+  // nothing queued points into recv_buf, reading may move it
+  while (1)
+  {
+    char *buf = client_info->recv_buf + client_info->recv_start;
+    size_t len = client_info->recv_len - client_info->recv_start;
+    if (len > 0)
+    {
+      uint64_t start = stats_now();
+      parse_err = parse_http_request(buf, len, &request, &client_info->scan_offset);
+      if (parse_err != TEST_ERROR_PARSE_PARTIAL)
+      {
+        stats_record(stats, STATS_PHASE_PARSE, start);
+        break;
+      }
+      stats_add(&stats->parse_partial, 1);
+      LOG_DEBUG("parsing partial'ed %zu bytes", len);
+    }
+    if (!client_info->want_out && (client_flush(client_info) == OUT_FAILED))
+      return CLIENT_CLOSE;
+    int n = recv_more(client_info);
+    if (n == -1)
+    {
+      client_deadline(client_info, len > 0 ? DEADLINE_HEADER : DEADLINE_IDLE);
+      return CLIENT_KEEP;
+    }
+    if (n <= 0)
+      return CLIENT_CLOSE;
+  }
+
+  int wrong_version = (strcmp(request.http_version, "HTTP/1.1") != 0);
+  int no_method = ((strcmp(request.http_method, "GET") != 0) && (strcmp(request.http_method, "HEAD") != 0) && (strcmp(request.http_method, "POST") != 0));
+  int is_req_invalid = (parse_err == TEST_ERROR_PARSE_FAILED) || wrong_version ||
+                       no_method;
+  client_info->method = stats_method(request.http_method);
+  client_info->response_start = client_info->queued;
+  client_info->request_line = NULL;
+  if (is_req_invalid)
+  { // || wrong_version || no_method) {
+    LOG_DEBUG("parsing failed, sending HTTP 400");
+    if (parse_err == TEST_ERROR_PARSE_FAILED)
+      stats_add(&stats->parse_failed, 1);
+    else
+      keep_request_line(client_info, &request);
+    // send HTTP 400
+    respond_error(client_info, HTTP_400);
+    // we can't tell where a malformed request ends, so there is no way to
+    // skip past it to the next one
+    if (parse_err == TEST_ERROR_PARSE_FAILED)
+      return CLIENT_CLOSE;
+  }
+  size_t content_length = request.content_length;
+
+  // the body has to be buffered as well before the request is handled
+  size_t request_len = request.status_header_size + content_length;
+  if (request_len > MAX_RECV_BUF)
+    return CLIENT_CLOSE;
+  while (client_info->recv_len - client_info->recv_start < request_len)
+  {
+    if (!client_info->want_out && (client_flush(client_info) == OUT_FAILED))
+      return CLIENT_CLOSE;
+    int n = recv_more(client_info);
+    if (n == -1)
+    {
+      client_deadline(client_info, DEADLINE_BODY);
+      return CLIENT_KEEP;
+    }
+    if (n <= 0)
+      return CLIENT_CLOSE;
+  }
+  char *buf = client_info->recv_buf + client_info->recv_start;
+  // reading may have moved the buffer, the slices are relative to it
+  request.buf = buf;
+  // after reading, which may have reset the arena
+  keep_request_line(client_info, &request);
+
+  if (strcmp(request.http_method, "POST") == 0)
+  {
+    LOG_DEBUG("echoing POST of %zu bytes", request_len);
+    if (out_add_copy(client_info, buf, request_len))
+    {
+      count_response(client_info, HTTP_200);
+    }
+    else
+    {
+      respond_error(client_info, HTTP_500);
+    }
+  } else {
+
+  // serializing the request back is only worth it if it is logged
+  if (LOG_ENABLED(LOG_LEVEL_DEBUG))
+  {
+    char buffer[2 * HTTP_SIZE];
+    size_t size = 0;
+    serialize_http_request(buffer, &size, &request);
+    LOG_DEBUG("received HTTP request, %zu bytes (%zu of headers):\n%.*s", request_len,
+              request.status_header_size, (int)size, buffer);
+  }
+
+  if (!is_req_invalid)
+  {
+    uint64_t start = stats_now();
+    if (strcmp(request.http_uri, STATS_URI) == 0)
+      respond_stats(client_info);
+    else
+      parked = respond_static(client_info, &request, folder);
+    stats_record(stats, STATS_PHASE_HANDLE, start);
+  }
+
+  }
+  // the request is done with, the next one starts right after it
+  client_info->recv_start += request_len;
+  client_info->scan_offset = 0;
+  // and gets deadlines of its own, the timer is stopped along with them
+  client_deadline(client_info, DEADLINE_NONE);
+
+  // check for connection: close
+  int to_close = request_header_is(&request, HEADER_CONNECTION, "close");
+  if (to_close)
+  {
+    LOG_DEBUG("got a connection close: closing connection with fd %d", client_info->connfd);
+    if (!parked)
+      return CLIENT_CLOSE;
+  }
+  if (parked)
+  {
+    client_info->close_after = to_close;
+    return CLIENT_PARKED;
+  }
+  return CLIENT_PROGRESS;
+}
+
+/* sets up a non-blocking listening socket on HTTP_PORT with an accept
+  queue of backlog connections. every worker calls this, SO_REUSEPORT lets
+  them all bind the same port */
+int open_listen_socket(int backlog)
+{
+  int err;
+  int sockfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  ERR("couldn't make server socket\n", (sockfd < 0));
+  int optval = 1;
+  setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+  setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval));
+  /* tcp timeout */
+  optval = 3000;
+  setsockopt(sockfd, IPPROTO_TCP, TCP_USER_TIMEOUT, &optval, sizeof(optval));
+
+  struct sockaddr_in sin;
+  bzero((char *)&sin, sizeof(sin));
+  sin.sin_family = AF_INET;
+  sin.sin_addr.s_addr = INADDR_ANY;
+  sin.sin_port = htons(HTTP_PORT);
+
+  err = bind(sockfd, (struct sockaddr *)&sin, sizeof(sin));
+  ERR("couldn't bind\n", (err < 0));
+  listen(sockfd, backlog);
+  return sockfd;
+}
+
+/* sets up the worker's listening socket and epoll instance. done before any
+  thread starts so a bind failure stops the server right away */
+void worker_init(struct worker *worker)
+{
+  int err;
+  timer_wheel_init(&worker->timers, timer_now_ms());
+  worker->listenfd = open_listen_socket(worker->config->backlog);
+  worker->epfd = epoll_create1(0);
+  ERR("couldn't create epoll instance\n", (worker->epfd < 0));
+
+  // the listening socket is the only entry with a NULL data pointer, client
+  // entries point at their struct client_info
+  struct epoll_event ev;
+  ev.events = EPOLLIN | EPOLLET;
+  ev.data.ptr = NULL;
+  err = epoll_ctl(worker->epfd, EPOLL_CTL_ADD, worker->listenfd, &ev);
+  ERR("couldn't add server socket to epoll\n", (err < 0));
+
+  if (worker->config->cache_bytes > 0)
+  {
+    worker->cache = file_cache_create(worker->config->cache_bytes);
+    ERR("couldn't create response cache\n", (worker->cache == NULL));
+  }
+
+  // the ring signals completions through an eventfd, registered with the
+  // ring itself as its data pointer
+  if (worker->config->use_uring)
+    worker->ring = uring_create(URING_ENTRIES);
+  if (worker->ring != NULL)
+  {
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = worker->ring;
+    err = epoll_ctl(worker->epfd, EPOLL_CTL_ADD, worker->ring->eventfd, &ev);
+    ERR("couldn't add io_uring eventfd to epoll\n", (err < 0));
+  }
+  LOG_INFO("worker %d: %s file I/O", worker->id,
+           worker->ring != NULL ? "io_uring" : "synchronous");
+}
+
+/* registers the connection for EPOLLOUT on top of the events it always
+  waits for, or stops, when that changes */
+void client_want_out(struct client_info *client_info, bool want)
+{
+  if (want == client_info->want_out)
+    return;
+  struct epoll_event ev;
+  ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET | (want ? EPOLLOUT : 0);
+  ev.data.ptr = client_info;
+  if (epoll_ctl(client_info->worker->epfd, EPOLL_CTL_MOD, client_info->connfd, &ev) < 0)
+    LOG_WARN("couldn't update epoll events of fd %d: %s", client_info->connfd, strerror(errno));
+  client_info->want_out = want;
+}
+
+/* sends what the socket takes of the connection's output queue and waits
+  for EPOLLOUT while some is left, with the send deadline restarted. a
+  connection that is done with is closed once all of it is out. returns
+  false if it was closed */
+bool client_push(struct client_info *client_info)
+{
+  int res = client_flush(client_info);
+  if ((res == OUT_FAILED) || ((res == OUT_DONE) && client_info->close_after))
+  {
+    LOG_DEBUG("closing connection with fd %d", client_info->connfd);
+    close_connection(client_info);
+    return false;
+  }
+  client_want_out(client_info, res == OUT_BLOCKED);
+  if (res == OUT_BLOCKED)
+    client_deadline(client_info, DEADLINE_SEND);
+  return true;
+}
+
+/* sends what the socket takes of the connection's streamed response.
+  returns true once it is complete and the connection can go on with the
+  requests after it, false if it waits for EPOLLOUT or was closed */
+bool stream_continue(struct client_info *client_info)
+{
+  struct response_stream *stream = client_info->stream;
+  int res = stream_pump(client_info);
+  if (res == STREAM_BLOCKED)
+  {
+    client_want_out(client_info, true);
+    client_deadline(client_info, DEADLINE_SEND);
+    return false;
+  }
+  client_want_out(client_info, false);
+  // counted once its length is known
+  count_response(client_info, stream->status);
+  stream_end(client_info);
+  if ((res == STREAM_FAILED) || client_info->close_after)
+  {
+    LOG_DEBUG("closing connection with fd %d after streamed response", client_info->connfd);
+    close_connection(client_info);
+    return false;
+  }
+  return true;
+}
+
+/* handles everything the connection has sent, until it runs out of complete
+  requests or is parked on file I/O. closes it when it is done */
+void client_run(struct client_info *client_info, char *folder)
+{
+  // edge-triggered: keep going until client_update() runs out of
+  // complete requests, otherwise buffered requests would wait for the
+  // next edge
+  int keep;
+  while (1)
+  {
+    do
+    {
+      keep = client_update(client_info, folder);
+    } while (keep == CLIENT_PROGRESS);
+    // a stream the socket takes at once doesn't need to wait for EPOLLOUT
+    if ((keep != CLIENT_PARKED) || (client_info->stream == NULL))
+      break;
+    if (!stream_continue(client_info))
+      return;
+  }
+  // what a parked connection has queued waits for its job, which the arena
+  // holds. the file read is up to the server, so it runs without a deadline
+  if (keep == CLIENT_PARKED)
+  {
+    client_deadline(client_info, DEADLINE_NONE);
+    return;
+  }
+  // the responses so far still go out before a connection is closed
+  if (keep == CLIENT_CLOSE)
+    client_info->close_after = true;
+  client_push(client_info);
+}
+
+/* feeds the ring's completions to their jobs and resumes the connections
+  that are done waiting */
+void worker_reap(struct worker *worker)
+{
+  uint64_t count;
+  // only clears the eventfd, the completion queue is what counts
+  while (read(worker->ring->eventfd, &count, sizeof(count)) > 0)
+  {
+  }
+  void *user;
+  int res;
+  while (uring_complete(worker->ring, &user, &res))
+  {
+    struct client_info *client_info = user;
+    file_job_step(worker, client_info, res);
+    if (client_info->job.state != JOB_IDLE)
+      continue;
+    if (client_info->close_after)
+    {
+      client_push(client_info);
+      continue;
+    }
+    client_run(client_info, worker->config->www_folder);
+  }
+}
+
+/* accepts up to ACCEPT_BATCH pending connections. the listening socket is
+  edge-triggered, so accept_ready stays set until the queue is drained and
+  the next round comes back for the rest right away */
+void worker_accept(struct worker *worker)
+{
+  for (int i = 0; i < ACCEPT_BATCH; i++)
+  {
+    if (new_connection(worker) < 0)
+    {
+      worker->accept_ready = false;
+      return;
+    }
+  }
+}
+
+/* event loop of one worker, never returns */
+void *worker_run(void *arg)
+{
+  struct worker *worker = arg;
+  char *www_folder = worker->config->www_folder;
+  struct epoll_event events[MAX_EVENTS];
+
+  while (1)
+  {
+    // the wheel has to move on every tick while deadlines are running, and
+    // connections left in the accept queue are taken without waiting
+    int timeout = worker->timers.count > 0 ? TIMER_TICK_MS : DEFAULT_TIMEOUT;
+    if (worker->accept_ready)
+      timeout = 0;
+    int n_ready = epoll_wait(worker->epfd, events, MAX_EVENTS, timeout);
+    if (n_ready < 0)
+    {
+      if (errno != EINTR)
+        LOG_ERROR("epoll_wait failed: %s", strerror(errno));
+      continue;
+    }
+    // an empty wheel may have slept through many ticks, it has to be
+    // current before connections arm their timers
+    if (worker->timers.count == 0)
+      timer_wheel_advance(&worker->timers, timer_now_ms(), connection_expired, NULL);
+    if ((n_ready == 0) && (worker->timers.count == 0) && !worker->accept_ready)
+    {
+      LOG_DEBUG("worker %d: nothing so far, %llu open connections, %llu accepted", worker->id,
+                (unsigned long long)worker->stats->active,
+                (unsigned long long)worker->stats->accepted);
+      if (worker->cache != NULL)
+        LOG_DEBUG("worker %d: cache %zu entries, %zu bytes, %zu hits, %zu misses",
+                  worker->id, worker->cache->n_entries, worker->cache->used,
+                  worker->cache->hits, worker->cache->misses);
+      continue;
+    }
+
+    bool reap = false;
+    for (int i = 0; i < n_ready; i++)
+    {
+      struct client_info *client_info = events[i].data.ptr;
+      uint32_t revents = events[i].events;
+
+      /* new connections are accepted after the events of this round */
+      if (client_info == NULL)
+      {
+        worker->accept_ready = true;
+        continue;
+      }
+
+      // the ring's eventfd. its completions are handled last, they may close
+      // connections that further events of this round refer to
+      if ((void *)client_info == worker->ring)
+      {
+        reap = true;
+        continue;
+      }
+
+      // a parked connection is looked at again once its file is read, and a
+      // hangup shows up then as a failed recv()
+      if (client_info->job.state != JOB_IDLE)
+        continue;
+      // a streaming one only cares about room in the send buffer
+      if (client_info->stream != NULL)
+      {
+        if (revents & (EPOLLERR | EPOLLHUP))
+          close_connection(client_info);
+        else if ((revents & EPOLLOUT) && stream_continue(client_info))
+          client_run(client_info, www_folder);
+        continue;
+      }
+      bool input = (revents & (EPOLLIN | EPOLLRDHUP)) != 0;
+      if (revents & EPOLLOUT)
+      {
+        // room for more of the queue. requests are looked at again once it
+        // drained, or a connection that was backed up is down to the low
+        // watermark
+        bool backed_up = client_info->backed_up;
+        if (!client_push(client_info))
+          continue;
+        input = input || !client_info->want_out || backed_up;
+      }
+      else if (!input)
+      {
+        // EPOLLERR or EPOLLHUP without anything left to read
+        LOG_DEBUG("closing connection with fd %d after a hangup", client_info->connfd);
+        close_connection(client_info);
+        continue;
+      }
+      // a connection that is closing or backed up reads nothing more until
+      // the client takes its responses, the input waits in the socket
+      if (input && !client_info->close_after && !client_backed_up(client_info))
+        client_run(client_info, www_folder);
+    }
+    if (worker->accept_ready)
+      worker_accept(worker);
+    if (reap)
+      worker_reap(worker);
+    // last, expired connections may have had events in this round
+    timer_wheel_advance(&worker->timers, timer_now_ms(), connection_expired, NULL);
+  }
+  return NULL;
+}
+
+/* writes the counters to config->stats_file every stats_interval seconds.
+  the file is replaced whole, readers never see half of it */
+void *stats_dump_run(void *arg)
+{
+  const struct server_config *config = arg;
+  size_t path_len = strlen(config->stats_file);
+  char *tmp = malloc(path_len + sizeof(".tmp"));
+  struct stats_scratch *scratch = malloc(sizeof(struct stats_scratch));
+  ERR("couldn't allocate the stats dump\n",
+      (tmp == NULL) || (scratch == NULL) || !stats_scratch_init(scratch));
+  memcpy(tmp, config->stats_file, path_len);
+  strcpy(tmp + path_len, ".tmp");
+  while (1)
+  {
+    sleep(config->stats_interval);
+    size_t len = stats_format(config->stats, config->n_workers, scratch);
+    FILE *out = fopen(tmp, "w");
+    if (out == NULL)
+    {
+      LOG_WARN("couldn't write %s: %s", tmp, strerror(errno));
+      continue;
+    }
+    bool ok = fwrite(scratch->json, 1, len, out) == len;
+    if ((fclose(out) != 0) || !ok || (rename(tmp, config->stats_file) != 0))
+      LOG_WARN("couldn't write %s: %s", config->stats_file, strerror(errno));
+  }
+  return NULL;
+}
+
+void usage(char *prog)
+{
+  fprintf(stderr, "usage: %s [--workers N] [--cache-size MB] [--parser fast|bison|diff] [--file-io uring|sync] [--autoindex] [--stats-file PATH] [--stats-interval SECS] [--log-level debug|info|warn|error] [--log-file PATH] [--access-log PATH] [--max-conns N] [--max-conns-per-ip N] [--conn-rate PER_SEC] [--conn-burst N] [--backlog N] <www-folder>\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+  // sendfile() has no MSG_NOSIGNAL: a client that resets the connection
+  // mid-file would raise SIGPIPE and take the whole server down. the send
+  // fails with EPIPE instead
+  signal(SIGPIPE, SIG_IGN);
+
+  /* Validate and parse args */
+  struct server_config config;
+  config.n_workers = 1;
+  config.use_uring = true;
+  config.autoindex = false;
+  config.stats_file = NULL;
+  config.stats_interval = STATS_DUMP_SECS;
+  config.backlog = LISTEN_BACKLOG;
+  config.admission = NULL;
+  long cache_mb = DEFAULT_CACHE_MB;
+  long max_conns = MAX_CONCURRENT_CONNS;
+  long max_per_ip = 0;
+  long conn_rate = 0;
+  long conn_burst = 0;
+  char *log_file = NULL;
+  char *access_log = NULL;
+
+  static struct option long_options[] = {
+      {"workers", required_argument, NULL, 'w'},
+      {"cache-size", required_argument, NULL, 'c'},
+      {"parser", required_argument, NULL, 'p'},
+      {"file-io", required_argument, NULL, 'f'},
+      {"autoindex", no_argument, NULL, 'a'},
+      {"stats-file", required_argument, NULL, 's'},
+      {"stats-interval", required_argument, NULL, 'i'},
+      {"log-level", required_argument, NULL, 'l'},
+      {"log-file", required_argument, NULL, 'o'},
+      {"access-log", required_argument, NULL, 'A'},
+      {"max-conns", required_argument, NULL, 'm'},
+      {"max-conns-per-ip", required_argument, NULL, 'P'},
+      {"conn-rate", required_argument, NULL, 'r'},
+      {"conn-burst", required_argument, NULL, 'b'},
+      {"backlog", required_argument, NULL, 'B'},
+      {NULL, 0, NULL, 0}};
+  int opt;
+  while ((opt = getopt_long(argc, argv, "w:c:p:f:as:i:l:o:A:m:P:r:b:B:", long_options, NULL)) !=
+         -1)
+  {
+    switch (opt)
+    {
+    case 'c':
+      cache_mb = atol(optarg);
+      if (cache_mb < 0)
+      {
+        fprintf(stderr, "--cache-size can't be negative\n");
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'w':
+      config.n_workers = atoi(optarg);
+      if ((config.n_workers < 1) || (config.n_workers > MAX_WORKERS))
+      {
+        fprintf(stderr, "--workers must be between 1 and %d\n", MAX_WORKERS);
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'p':
+      if (strcmp(optarg, "fast") == 0)
+        set_parser_mode(PARSER_FAST);
+      else if (strcmp(optarg, "bison") == 0)
+        set_parser_mode(PARSER_BISON);
+      else if (strcmp(optarg, "diff") == 0)
+        set_parser_mode(PARSER_DIFF);
+      else
+      {
+        fprintf(stderr, "--parser must be fast, bison or diff\n");
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'f':
+      if (strcmp(optarg, "uring") == 0)
+        config.use_uring = true;
+      else if (strcmp(optarg, "sync") == 0)
+        config.use_uring = false;
+      else
+      {
+        fprintf(stderr, "--file-io must be uring or sync\n");
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'a':
+      config.autoindex = true;
+      break;
+    case 's':
+      config.stats_file = optarg;
+      break;
+    case 'i':
+      config.stats_interval = atoi(optarg);
+      if (config.stats_interval < 1)
+      {
+        fprintf(stderr, "--stats-interval must be at least 1 second\n");
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'l':
+      log_level = log_parse_level(optarg);
+      if (log_level < 0)
+      {
+        fprintf(stderr, "--log-level must be debug, info, warn or error\n");
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'o':
+      log_file = optarg;
+      break;
+    case 'A':
+      access_log = optarg;
+      break;
+    case 'm':
+      max_conns = atol(optarg);
+      if (max_conns < 1)
+      {
+        fprintf(stderr, "--max-conns must be at least 1\n");
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'P':
+      max_per_ip = atol(optarg);
+      break;
+    case 'r':
+      conn_rate = atol(optarg);
+      break;
+    case 'b':
+      conn_burst = atol(optarg);
+      break;
+    case 'B':
+      config.backlog = atoi(optarg);
+      if (config.backlog < 1)
+      {
+        fprintf(stderr, "--backlog must be at least 1\n");
+        return EXIT_FAILURE;
+      }
+      break;
+    default:
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (optind != argc - 1)
+  {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if ((max_per_ip < 0) || (max_per_ip > UINT32_MAX) || (conn_rate < 0) ||
+      (conn_rate > UINT32_MAX) || (conn_burst < 0) || (conn_burst > UINT32_MAX))
+  {
+    fprintf(stderr, "--max-conns-per-ip, --conn-rate and --conn-burst must be between 0 and %u\n",
+            UINT32_MAX);
+    return EXIT_FAILURE;
+  }
+
+  config.www_folder = argv[optind];
+  // every worker has its own cache, so nothing is shared on the request path
+  config.cache_bytes = (size_t)cache_mb * 1024 * 1024 / config.n_workers;
+  // and counts its own connections against its share of the limit
+  config.max_conns = (max_conns + config.n_workers - 1) / config.n_workers;
+
+  DIR *www_dir = opendir(config.www_folder);
+  if (www_dir == NULL)
+  {
+    fprintf(stderr, "Unable to open www folder %s.\n", config.www_folder);
+    return EXIT_FAILURE;
+  }
+
+  closedir(www_dir);
+
+  FILE *log_out = stdout;
+  FILE *access_out = NULL;
+  if (log_file != NULL)
+  {
+    log_out = fopen(log_file, "a");
+    if (log_out == NULL)
+    {
+      fprintf(stderr, "Unable to open log file %s: %s\n", log_file, strerror(errno));
+      return EXIT_FAILURE;
+    }
+  }
+  if (access_log != NULL)
+  {
+    access_out = fopen(access_log, "a");
+    if (access_out == NULL)
+    {
+      fprintf(stderr, "Unable to open access log %s: %s\n", access_log, strerror(errno));
+      return EXIT_FAILURE;
+    }
+  }
+  ERR("couldn't start the log thread\n", !log_start(log_out, access_out));
+
+  LOG_INFO("setting up %d worker(s)", config.n_workers);
+  LOG_INFO("request parser: %s (%s)",
+           get_parser_mode() == PARSER_FAST ? "fast" : get_parser_mode() == PARSER_BISON ? "bison" : "diff",
+           fast_parse_isa());
+
+  /* every connection is an fd, so allow as many as the hard limit permits */
+  struct rlimit rl;
+  if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max)
+  {
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+  }
+
+  // a client's connections land on any worker, so its limits are shared.
+  // the burst defaults to a second's worth of connections
+  if ((max_per_ip > 0) || (conn_rate > 0))
+  {
+    config.admission = admission_create(max_per_ip, conn_rate,
+                                        conn_burst > 0 ? conn_burst : conn_rate);
+    ERR("couldn't allocate the admission limits\n", (config.admission == NULL));
+    LOG_INFO("per client: %ld connections, %ld new a second, bursts of %ld", max_per_ip,
+             conn_rate, conn_burst > 0 ? conn_burst : conn_rate);
+  }
+
+  struct worker *workers = calloc(config.n_workers, sizeof(struct worker));
+  config.stats = calloc(config.n_workers, sizeof(struct worker_stats));
+  ERR("couldn't allocate workers\n", (workers == NULL) || (config.stats == NULL));
+  for (int i = 0; i < config.n_workers; i++)
+  {
+    workers[i].id = i;
+    workers[i].config = &config;
+    workers[i].stats = &config.stats[i];
+    ERR("couldn't allocate worker stats\n", !stats_init(workers[i].stats));
+    worker_init(&workers[i]);
+    workers[i].stats->cache = workers[i].cache;
+  }
+
+  if (config.stats_file != NULL)
+  {
+    pthread_t dump_thread;
+    int err = pthread_create(&dump_thread, NULL, stats_dump_run, &config);
+    ERR("couldn't start the stats dump thread\n", (err != 0));
+    pthread_detach(dump_thread);
+  }
+
+  // worker 0 runs on the main thread
+  for (int i = 1; i < config.n_workers; i++)
+  {
+    int err = pthread_create(&workers[i].thread, NULL, worker_run, &workers[i]);
+    ERR("couldn't start worker thread\n", (err != 0));
+  }
+  worker_run(&workers[0]);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,182 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the HTTP course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the HTTP project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stats.h"
+#include "file_cache.h"
+
+static const char *METHOD_NAMES[STATS_METHOD_COUNT] = {"GET", "HEAD", "POST", "other"};
+static const char *PHASE_NAMES[STATS_PHASE_COUNT] = {"parse", "handle", "file_io", "send"};
+
+bool stats_init(struct worker_stats *stats)
+{
+  memset(stats, 0, sizeof(*stats));
+  for (int i = 0; i < STATS_PHASE_COUNT; i++)
+  {
+    if (!histogram_init(&stats->phases[i]))
+    {
+      stats_destroy(stats);
+      return false;
+    }
+  }
+  return true;
+}
+
+void stats_destroy(struct worker_stats *stats)
+{
+  for (int i = 0; i < STATS_PHASE_COUNT; i++)
+    histogram_destroy(&stats->phases[i]);
+}
+
+Stats_method stats_method(const char *method)
+{
+  if (strcmp(method, "GET") == 0)
+    return STATS_GET;
+  if (strcmp(method, "HEAD") == 0)
+    return STATS_HEAD;
+  if (strcmp(method, "POST") == 0)
+    return STATS_POST;
+  return STATS_OTHER;
+}
+
+void stats_count_response(struct worker_stats *stats, Stats_method method, Http_status status)
+{
+  stats_add(&stats->responses[method][status], 1);
+}
+
+uint64_t stats_now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void stats_record(struct worker_stats *stats, Stats_phase phase, uint64_t start)
+{
+  histogram_record(&stats->phases[phase], stats_now() - start, 1);
+}
+
+bool stats_scratch_init(struct stats_scratch *scratch)
+{
+  for (int i = 0; i < STATS_PHASE_COUNT; i++)
+  {
+    if (!histogram_init(&scratch->phases[i]))
+    {
+      while (i-- > 0)
+        histogram_destroy(&scratch->phases[i]);
+      return false;
+    }
+  }
+  return true;
+}
+
+void stats_scratch_destroy(struct stats_scratch *scratch)
+{
+  for (int i = 0; i < STATS_PHASE_COUNT; i++)
+    histogram_destroy(&scratch->phases[i]);
+}
+
+static uint64_t load(const uint64_t *counter)
+{
+  return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+/* snprintf() that keeps track of the room left and of running out of it */
+#define APPEND_JSON(...)                                              \
+  do                                                                  \
+  {                                                                   \
+    if (len < STATS_JSON_MAX)                                         \
+      len += snprintf(buf + len, STATS_JSON_MAX - len, __VA_ARGS__);  \
+  } while (0)
+
+size_t stats_format(struct worker_stats *stats, int n_workers, struct stats_scratch *scratch)
+{
+  struct histogram *phases = scratch->phases;
+  char *buf = scratch->json;
+  for (int i = 0; i < STATS_PHASE_COUNT; i++)
+    histogram_reset(&phases[i]);
+
+  uint64_t responses[STATS_METHOD_COUNT][HTTP_STATUS_COUNT] = {{0}};
+  uint64_t bytes_sent = 0, accepted = 0, active = 0, rejected = 0, timed_out = 0;
+  uint64_t shed_per_ip = 0, shed_rate = 0;
+  uint64_t parse_failed = 0, parse_partial = 0, hits = 0, misses = 0;
+  for (int w = 0; w < n_workers; w++)
+  {
+    struct worker_stats *s = &stats[w];
+    for (int m = 0; m < STATS_METHOD_COUNT; m++)
+      for (int st = 0; st < HTTP_STATUS_COUNT; st++)
+        responses[m][st] += load(&s->responses[m][st]);
+    bytes_sent += load(&s->bytes_sent);
+    accepted += load(&s->accepted);
+    active += load(&s->active);
+    rejected += load(&s->rejected);
+    shed_per_ip += load(&s->shed_per_ip);
+    shed_rate += load(&s->shed_rate);
+    timed_out += load(&s->timed_out);
+    parse_failed += load(&s->parse_failed);
+    parse_partial += load(&s->parse_partial);
+    if (s->cache != NULL)
+    {
+      hits += __atomic_load_n(&s->cache->hits, __ATOMIC_RELAXED);
+      misses += __atomic_load_n(&s->cache->misses, __ATOMIC_RELAXED);
+    }
+    for (int p = 0; p < STATS_PHASE_COUNT; p++)
+      histogram_merge(&phases[p], &s->phases[p]);
+  }
+
+  size_t len = 0;
+  uint64_t total = 0;
+  APPEND_JSON("{\"workers\": %d, \"responses\": {", n_workers);
+  for (int m = 0; m < STATS_METHOD_COUNT; m++)
+  {
+    APPEND_JSON("%s\"%s\": {", m > 0 ? ", " : "", METHOD_NAMES[m]);
+    bool first = true;
+    for (int st = 0; st < HTTP_STATUS_COUNT; st++)
+    {
+      if (responses[m][st] == 0)
+        continue;
+      // "HTTP/1.1 200 OK"
+      APPEND_JSON("%s\"%.3s\": %llu", first ? "" : ", ", STATUS_LINES[st].str + 9,
+                  (unsigned long long)responses[m][st]);
+      first = false;
+      total += responses[m][st];
+    }
+    APPEND_JSON("}");
+  }
+  APPEND_JSON("}, \"requests\": %llu, \"bytes_sent\": %llu, ", (unsigned long long)total,
+              (unsigned long long)bytes_sent);
+  APPEND_JSON("\"connections\": {\"accepted\": %llu, \"active\": %llu, \"rejected_503\": %llu, "
+              "\"shed_per_ip\": %llu, \"shed_rate\": %llu, \"timed_out\": %llu}, ",
+              (unsigned long long)accepted, (unsigned long long)active, (unsigned long long)rejected,
+              (unsigned long long)shed_per_ip, (unsigned long long)shed_rate,
+              (unsigned long long)timed_out);
+  APPEND_JSON("\"parse\": {\"failed\": %llu, \"partial\": %llu}, ", (unsigned long long)parse_failed,
+              (unsigned long long)parse_partial);
+  APPEND_JSON("\"cache\": {\"hits\": %llu, \"misses\": %llu, \"hit_rate\": %.4f}, ",
+              (unsigned long long)hits, (unsigned long long)misses,
+              hits + misses > 0 ? (double)hits / (hits + misses) : 0.0);
+  APPEND_JSON("\"latency_us\": {");
+  for (int p = 0; p < STATS_PHASE_COUNT; p++)
+  {
+    const struct histogram *h = &phases[p];
+    APPEND_JSON("%s\"%s\": {\"count\": %llu, \"mean\": %.1f, \"p50\": %.1f, \"p90\": %.1f, "
+                "\"p99\": %.1f, \"p99.9\": %.1f, \"max\": %.1f}",
+                p > 0 ? ", " : "", PHASE_NAMES[p], (unsigned long long)h->total,
+                h->total > 0 ? h->sum / h->total / 1e3 : 0.0, histogram_quantile(h, 0.5) / 1e3,
+                histogram_quantile(h, 0.9) / 1e3, histogram_quantile(h, 0.99) / 1e3,
+                histogram_quantile(h, 0.999) / 1e3, h->max / 1e3);
+  }
+  APPEND_JSON("}}\n");
+  return len < STATS_JSON_MAX ? len : 0;
+}
@@ -0,0 +1,147 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the HTTP course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the HTTP project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include <time.h>
+
+#include "timer_wheel.h"
+
+#define SLOT_MASK (TIMER_SLOTS - 1)
+// Ticks level covers from the current one on
+#define LEVEL_SPAN(__level) ((uint64_t)1 << (TIMER_SLOT_BITS * ((__level) + 1)))
+
+static void list_init(struct timer *head)
+{
+  head->next = head;
+  head->prev = head;
+}
+
+static void unlink_timer(struct timer *timer)
+{
+  timer->prev->next = timer->next;
+  timer->next->prev = timer->prev;
+  timer->next = NULL;
+  timer->prev = NULL;
+}
+
+/* puts the timer into the lowest level whose span reaches its expiry, in
+  the slot of its expiry at that level. a slot of level L is cascaded into
+  the levels below when the wheel reaches the start of its span, so the
+  timer moves down until it fires from level 0 */
+static void place(struct timer_wheel *wheel, struct timer *timer)
+{
+  if (timer->expires < wheel->now)
+    timer->expires = wheel->now;
+  uint64_t delta = timer->expires - wheel->now;
+  int level = 0;
+  while ((level < TIMER_LEVELS - 1) && (delta >= LEVEL_SPAN(level)))
+    level++;
+  if (delta >= LEVEL_SPAN(TIMER_LEVELS - 1))
+    timer->expires = wheel->now + LEVEL_SPAN(TIMER_LEVELS - 1) - 1;
+  struct timer *head =
+      &wheel->slots[level][(timer->expires >> (TIMER_SLOT_BITS * level)) & SLOT_MASK];
+  timer->prev = head->prev;
+  timer->next = head;
+  head->prev->next = timer;
+  head->prev = timer;
+}
+
+void timer_wheel_init(struct timer_wheel *wheel, uint64_t now)
+{
+  wheel->now = now / TIMER_TICK_MS;
+  wheel->count = 0;
+  for (int level = 0; level < TIMER_LEVELS; level++)
+    for (int slot = 0; slot < TIMER_SLOTS; slot++)
+      list_init(&wheel->slots[level][slot]);
+}
+
+void timer_init(struct timer *timer)
+{
+  timer->next = NULL;
+  timer->prev = NULL;
+  timer->expires = 0;
+}
+
+bool timer_armed(const struct timer *timer)
+{
+  return timer->next != NULL;
+}
+
+void timer_arm(struct timer_wheel *wheel, struct timer *timer, uint64_t timeout_ms)
+{
+  if (timer_armed(timer))
+    unlink_timer(timer);
+  else
+    wheel->count++;
+  // at least a tick away, the current tick's slot was already handled
+  uint64_t ticks = (timeout_ms + TIMER_TICK_MS - 1) / TIMER_TICK_MS;
+  timer->expires = wheel->now + (ticks > 0 ? ticks : 1);
+  place(wheel, timer);
+}
+
+void timer_cancel(struct timer_wheel *wheel, struct timer *timer)
+{
+  if (!timer_armed(timer))
+    return;
+  unlink_timer(timer);
+  wheel->count--;
+}
+
+/* moves the timers of a slot down to where they belong now */
+static void cascade(struct timer_wheel *wheel, int level)
+{
+  struct timer *head =
+      &wheel->slots[level][(wheel->now >> (TIMER_SLOT_BITS * level)) & SLOT_MASK];
+  struct timer *timer = head->next;
+  list_init(head);
+  while (timer != head)
+  {
+    struct timer *next = timer->next;
+    place(wheel, timer);
+    timer = next;
+  }
+}
+
+size_t timer_wheel_advance(struct timer_wheel *wheel, uint64_t now,
+                           void (*expire)(struct timer *timer, void *arg), void *arg)
+{
+  uint64_t target = now / TIMER_TICK_MS;
+  size_t fired = 0;
+  while ((wheel->now < target) && (wheel->count > 0))
+  {
+    wheel->now++;
+    // a level is cascaded whenever the one below wraps around
+    for (int level = 1; level < TIMER_LEVELS; level++)
+    {
+      if ((wheel->now & (LEVEL_SPAN(level - 1) - 1)) != 0)
+        break;
+      cascade(wheel, level);
+    }
+    struct timer *head = &wheel->slots[0][wheel->now & SLOT_MASK];
+    while (head->next != head)
+    {
+      struct timer *timer = head->next;
+      unlink_timer(timer);
+      wheel->count--;
+      fired++;
+      expire(timer, arg);
+    }
+  }
+  // an empty wheel just jumps ahead
+  if (wheel->now < target)
+    wheel->now = target;
+  return fired;
+}
+
+uint64_t timer_now_ms()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
@@ -0,0 +1,262 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the HTTP course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the HTTP project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "uring.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING
+#endif
+#endif
+
+#ifdef HAVE_IO_URING
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+#include <linux/io_uring.h>
+
+/* no liburing, these are the three system calls it wraps */
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+  return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+  return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+  return syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+/* the kernel has to support every operation the server queues */
+static bool has_ops(int fd)
+{
+  static const int needed[] = {IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ};
+  size_t len = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+  struct io_uring_probe *probe = calloc(1, len);
+  if (probe == NULL)
+    return false;
+  bool ok = sys_io_uring_register(fd, IORING_REGISTER_PROBE, probe, 256) == 0;
+  for (size_t i = 0; ok && (i < sizeof(needed) / sizeof(needed[0])); i++)
+    ok = (needed[i] <= probe->last_op) && (probe->ops[needed[i]].flags & IO_URING_OP_SUPPORTED);
+  free(probe);
+  return ok;
+}
+
+struct uring *uring_create(unsigned entries)
+{
+  struct io_uring_params p;
+  memset(&p, 0, sizeof(p));
+  int fd = sys_io_uring_setup(entries, &p);
+  if (fd < 0)
+    return NULL; // ENOSYS, or EPERM under a seccomp policy
+  if (!(p.features & IORING_FEAT_SINGLE_MMAP) || !has_ops(fd))
+  {
+    close(fd);
+    return NULL;
+  }
+
+  struct uring *ring = calloc(1, sizeof(struct uring));
+  if (ring == NULL)
+  {
+    close(fd);
+    return NULL;
+  }
+  ring->fd = fd;
+  ring->eventfd = -1;
+
+  // with IORING_FEAT_SINGLE_MMAP both rings share one mapping
+  size_t sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  size_t cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  ring->sq_map_len = sq_len > cq_len ? sq_len : cq_len;
+  ring->sq_map = mmap(NULL, ring->sq_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      fd, IORING_OFF_SQ_RING);
+  ring->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    fd, IORING_OFF_SQES);
+  if ((ring->sq_map == MAP_FAILED) || (ring->sqes == MAP_FAILED))
+  {
+    if (ring->sq_map == MAP_FAILED)
+      ring->sq_map = NULL;
+    if (ring->sqes == MAP_FAILED)
+      ring->sqes = NULL;
+    uring_destroy(ring);
+    return NULL;
+  }
+
+  char *sq = ring->sq_map;
+  ring->sq_head = (unsigned *)(sq + p.sq_off.head);
+  ring->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+  ring->sq_mask = *(unsigned *)(sq + p.sq_off.ring_mask);
+  ring->sq_array = (unsigned *)(sq + p.sq_off.array);
+  ring->sq_entries = p.sq_entries;
+  ring->cq_head = (unsigned *)(sq + p.cq_off.head);
+  ring->cq_tail = (unsigned *)(sq + p.cq_off.tail);
+  ring->cq_mask = *(unsigned *)(sq + p.cq_off.ring_mask);
+  ring->cqes = sq + p.cq_off.cqes;
+  ring->cq_entries = p.cq_entries;
+
+  ring->eventfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if ((ring->eventfd < 0) ||
+      (sys_io_uring_register(fd, IORING_REGISTER_EVENTFD, &ring->eventfd, 1) < 0))
+  {
+    uring_destroy(ring);
+    return NULL;
+  }
+  return ring;
+}
+
+static struct io_uring_sqe *get_sqe(struct uring *ring, void *user)
+{
+  unsigned tail = *ring->sq_tail;
+  unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+  // also keep completions from outrunning the completion queue
+  if ((tail - head == ring->sq_entries) || (ring->in_flight == ring->cq_entries))
+    return NULL;
+  unsigned idx = tail & ring->sq_mask;
+  struct io_uring_sqe *sqe = (struct io_uring_sqe *)ring->sqes + idx;
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->user_data = (unsigned long)user;
+  ring->sq_array[idx] = idx;
+  // the kernel may look at the entry as soon as it sees the new tail
+  __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+  ring->to_submit++;
+  ring->in_flight++;
+  return sqe;
+}
+
+bool uring_openat(struct uring *ring, const char *path, int flags, void *user)
+{
+  struct io_uring_sqe *sqe = get_sqe(ring, user);
+  if (sqe == NULL)
+    return false;
+  sqe->opcode = IORING_OP_OPENAT;
+  sqe->fd = AT_FDCWD;
+  sqe->addr = (unsigned long)path;
+  sqe->open_flags = flags;
+  return true;
+}
+
+bool uring_statx(struct uring *ring, int fd, struct statx *stx, void *user)
+{
+  struct io_uring_sqe *sqe = get_sqe(ring, user);
+  if (sqe == NULL)
+    return false;
+  sqe->opcode = IORING_OP_STATX;
+  sqe->fd = fd;
+  sqe->addr = (unsigned long)"";
+  sqe->len = STATX_BASIC_STATS;
+  sqe->off = (unsigned long)stx;
+  sqe->statx_flags = AT_EMPTY_PATH;
+  return true;
+}
+
+bool uring_read(struct uring *ring, int fd, void *buf, size_t len, off_t offset, void *user)
+{
+  struct io_uring_sqe *sqe = get_sqe(ring, user);
+  if (sqe == NULL)
+    return false;
+  sqe->opcode = IORING_OP_READ;
+  sqe->fd = fd;
+  sqe->addr = (unsigned long)buf;
+  sqe->len = len;
+  sqe->off = offset;
+  return true;
+}
+
+void uring_submit(struct uring *ring)
+{
+  while (ring->to_submit > 0)
+  {
+    int n = sys_io_uring_enter(ring->fd, ring->to_submit, 0, 0);
+    if (n < 0)
+    {
+      if ((errno == EINTR) || (errno == EAGAIN) || (errno == EBUSY))
+        continue;
+      return;
+    }
+    ring->to_submit -= n;
+  }
+}
+
+bool uring_complete(struct uring *ring, void **user, int *res)
+{
+  unsigned head = *ring->cq_head;
+  if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+    return false;
+  struct io_uring_cqe *cqe = (struct io_uring_cqe *)ring->cqes + (head & ring->cq_mask);
+  *user = (void *)(unsigned long)cqe->user_data;
+  *res = cqe->res;
+  __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+  ring->in_flight--;
+  return true;
+}
+
+void uring_destroy(struct uring *ring)
+{
+  if (ring->sqes != NULL)
+    munmap(ring->sqes, ring->sqes_len);
+  if (ring->sq_map != NULL)
+    munmap(ring->sq_map, ring->sq_map_len);
+  if (ring->eventfd >= 0)
+    close(ring->eventfd);
+  close(ring->fd);
+  free(ring);
+}
+
+#else
+
+/* no io_uring headers at build time: every caller takes the synchronous
+  path */
+struct uring *uring_create(unsigned entries)
+{
+  return NULL;
+}
+
+bool uring_openat(struct uring *ring, const char *path, int flags, void *user)
+{
+  return false;
+}
+
+bool uring_statx(struct uring *ring, int fd, struct statx *stx, void *user)
+{
+  return false;
+}
+
+bool uring_read(struct uring *ring, int fd, void *buf, size_t len, off_t offset, void *user)
+{
+  return false;
+}
+
+void uring_submit(struct uring *ring)
+{
+}
+
+bool uring_complete(struct uring *ring, void **user, int *res)
+{
+  return false;
+}
+
+void uring_destroy(struct uring *ring)
+{
+}
+
+#endif